@@ -0,0 +1,458 @@
+#ifndef AUGMENTED_AVLBST_H
+#define AUGMENTED_AVLBST_H
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include "avlbst.h"
+
+/**
+* Monoids for AugmentedAVLTree. A monoid supplies
+*
+*   typedef ... Summary;
+*   Summary identity() const;
+*   Summary measure(const Key& key, const Value& value) const;
+*   Summary combine(const Summary& left, const Summary& right) const;
+*
+* combine() must be associative and identity() its neutral element. It
+* need not be commutative: summaries are always combined in key order.
+*/
+
+// Number of items. Node summaries are subtree sizes, and aggregateBelow(k)
+// is the rank of k.
+struct CountMonoid
+{
+    typedef uint64_t Summary;
+    Summary identity() const { return 0; }
+    template<class Key, class Value>
+    Summary measure(const Key& key, const Value& value) const { return 1; }
+    Summary combine(const Summary& left, const Summary& right) const { return left + right; }
+};
+
+template<typename T>
+struct SumMonoid
+{
+    typedef T Summary;
+    Summary identity() const { return T(); }
+    template<class Key>
+    Summary measure(const Key& key, const T& value) const { return value; }
+    Summary combine(const Summary& left, const Summary& right) const { return left + right; }
+};
+
+template<typename T>
+struct MinMonoid
+{
+    typedef T Summary;
+    Summary identity() const { return std::numeric_limits<T>::max(); }
+    template<class Key>
+    Summary measure(const Key& key, const T& value) const { return value; }
+    Summary combine(const Summary& left, const Summary& right) const { return (right < left) ? right : left; }
+};
+
+template<typename T>
+struct MaxMonoid
+{
+    typedef T Summary;
+    Summary identity() const { return std::numeric_limits<T>::lowest(); }
+    template<class Key>
+    Summary measure(const Key& key, const T& value) const { return value; }
+    Summary combine(const Summary& left, const Summary& right) const { return (left < right) ? right : left; }
+};
+
+/**
+* An AVLNode that also stores the summary of its subtree.
+*/
+template <typename Key, typename Value, typename Summary>
+class AugmentedAVLNode : public AVLNode<Key, Value>
+{
+public:
+    AugmentedAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent, const Summary& summary);
+    virtual ~AugmentedAVLNode();
+
+    const Summary& getSummary() const;
+    void setSummary(const Summary& summary);
+
+protected:
+    Summary summary_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the AugmentedAVLNode class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value, class Summary>
+AugmentedAVLNode<Key, Value, Summary>::AugmentedAVLNode(const Key& key, const Value& value,
+    AVLNode<Key, Value>* parent, const Summary& summary) :
+    AVLNode<Key, Value>(key, value, parent), summary_(summary)
+{
+
+}
+
+template<class Key, class Value, class Summary>
+AugmentedAVLNode<Key, Value, Summary>::~AugmentedAVLNode()
+{
+
+}
+
+template<class Key, class Value, class Summary>
+const Summary& AugmentedAVLNode<Key, Value, Summary>::getSummary() const
+{
+    return summary_;
+}
+
+template<class Key, class Value, class Summary>
+void AugmentedAVLNode<Key, Value, Summary>::setSummary(const Summary& summary)
+{
+    summary_ = summary;
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the AugmentedAVLNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An AVLTree whose nodes keep a monoid summary of their subtree, so the
+* summary of any key range comes out of two root-to-leaf paths.
+*
+* Summaries follow insert(), upsert(), remove(), erase(), lazy deletes
+* (tombstones count as the identity) and bulk loads in O(log n) per
+* change. Set operations and erase(first, last) resummarize the whole
+* tree afterwards, O(n). A value changed in place through a reference
+* (operator[], getOrInsert(), an iterator) is not seen until
+* refresh(key) is called.
+*/
+template <typename Key, typename Value, typename Monoid>
+class AugmentedAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef typename Monoid::Summary Summary;
+
+    explicit AugmentedAVLTree(const Monoid& monoid = Monoid());
+
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    template<class Combine>
+    void upsert(const Key& key, const Value& value, Combine combine);
+    void refresh(const Key& key);
+
+    // The set operations move nodes between the trees, so both sides
+    // must carry summaries of the same monoid.
+    template<class Merge>
+    void union_with(AugmentedAVLTree<Key, Value, Monoid>& other, Merge merge);
+    void union_with(AugmentedAVLTree<Key, Value, Monoid>& other);
+    template<class Merge>
+    void intersect_with(AugmentedAVLTree<Key, Value, Monoid>& other, Merge merge);
+    void intersect_with(AugmentedAVLTree<Key, Value, Monoid>& other);
+    void difference(AugmentedAVLTree<Key, Value, Monoid>& other);
+
+    Summary aggregate(const Key& lo, const Key& hi) const;
+    Summary aggregateBelow(const Key& hi) const;
+    Summary total() const;
+
+protected:
+    typedef AugmentedAVLNode<Key, Value, Summary> AugNode;
+
+    static AugNode* aug(Node<Key, Value>* n);
+    Summary summaryOf(Node<Key, Value>* n) const;
+    Summary measureOf(Node<Key, Value>* n) const;
+    void resummarize(Node<Key, Value>* n);
+    void resummarizeAll(Node<Key, Value>* n);
+
+    virtual Node<Key, Value>* makeNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void setBuiltHeights(Node<Key, Value>* n, int leftHeight, int rightHeight);
+    virtual void rotateRight(AVLNode<Key, Value>* node);
+    virtual void rotateLeft(AVLNode<Key, Value>* node);
+    virtual void refreshPath(AVLNode<Key, Value>* n);
+    virtual void rejoined();
+    virtual size_t nodeBytes() const;
+    virtual size_t balanceBytes() const;
+    virtual size_t treeBytes() const;
+
+    Monoid monoid_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the AugmentedAVLTree class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value, class Monoid>
+AugmentedAVLTree<Key, Value, Monoid>::AugmentedAVLTree(const Monoid& monoid) :
+    monoid_(monoid)
+{
+
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    BST_TIME(insert);
+    bool inserted;
+    Node<Key, Value>* n = this -> findOrInsert(keyValuePair.first, keyValuePair.second, inserted);
+    if (!inserted) {
+        n -> setValue(keyValuePair.second);
+        refreshPath(static_cast<AVLNode<Key, Value>*>(n));
+    }
+}
+
+template<class Key, class Value, class Monoid>
+template<class Combine>
+void AugmentedAVLTree<Key, Value, Monoid>::upsert(const Key& key, const Value& value, Combine combine)
+{
+    BST_TIME(insert);
+    bool inserted;
+    Node<Key, Value>* n = this -> findOrInsert(key, value, inserted);
+    if (!inserted) {
+        n -> setValue(combine(n -> getValue(), value));
+        refreshPath(static_cast<AVLNode<Key, Value>*>(n));
+    }
+}
+
+/**
+* Recomputes the summaries above key after its value was changed in place.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::refresh(const Key& key)
+{
+    Node<Key, Value>* n = this -> internalFind(key);
+    if (n != NULL) {
+        refreshPath(static_cast<AVLNode<Key, Value>*>(n));
+    }
+}
+
+template<class Key, class Value, class Monoid>
+template<class Merge>
+void AugmentedAVLTree<Key, Value, Monoid>::union_with(AugmentedAVLTree<Key, Value, Monoid>& other, Merge merge)
+{
+    AVLTree<Key, Value>::union_with(other, merge);
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::union_with(AugmentedAVLTree<Key, Value, Monoid>& other)
+{
+    AVLTree<Key, Value>::union_with(other);
+}
+
+template<class Key, class Value, class Monoid>
+template<class Merge>
+void AugmentedAVLTree<Key, Value, Monoid>::intersect_with(AugmentedAVLTree<Key, Value, Monoid>& other, Merge merge)
+{
+    AVLTree<Key, Value>::intersect_with(other, merge);
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::intersect_with(AugmentedAVLTree<Key, Value, Monoid>& other)
+{
+    AVLTree<Key, Value>::intersect_with(other);
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::difference(AugmentedAVLTree<Key, Value, Monoid>& other)
+{
+    AVLTree<Key, Value>::difference(other);
+}
+
+/**
+* Returns the combined summary of the items with lo <= key < hi, in key
+* order. Descends to the node where the paths to lo and hi split, then
+* down each side, taking whole subtrees that lie inside the range:
+* O(log n) combines.
+*/
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Summary
+AugmentedAVLTree<Key, Value, Monoid>::aggregate(const Key& lo, const Key& hi) const
+{
+    Node<Key, Value>* split = this -> root_;
+    while (split != NULL) {
+        if (split -> getKey() < lo) {
+            split = split -> getRight();
+        }
+        else if (!(split -> getKey() < hi)) {
+            split = split -> getLeft();
+        }
+        else {
+            break;
+        }
+    }
+    if (split == NULL) {
+        return monoid_.identity();
+    }
+
+    // keys >= lo in the left subtree, gathered right to left
+    Summary left = monoid_.identity();
+    for (Node<Key, Value>* n = split -> getLeft(); n != NULL; ) {
+        if (n -> getKey() < lo) {
+            n = n -> getRight();
+        }
+        else {
+            left = monoid_.combine(monoid_.combine(measureOf(n), summaryOf(n -> getRight())), left);
+            n = n -> getLeft();
+        }
+    }
+    // keys < hi in the right subtree, gathered left to right
+    Summary right = monoid_.identity();
+    for (Node<Key, Value>* n = split -> getRight(); n != NULL; ) {
+        if (n -> getKey() < hi) {
+            right = monoid_.combine(right, monoid_.combine(summaryOf(n -> getLeft()), measureOf(n)));
+            n = n -> getRight();
+        }
+        else {
+            n = n -> getLeft();
+        }
+    }
+    return monoid_.combine(monoid_.combine(left, measureOf(split)), right);
+}
+
+/**
+* Returns the combined summary of the items with key < hi. With
+* CountMonoid this is the rank of hi.
+*/
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Summary
+AugmentedAVLTree<Key, Value, Monoid>::aggregateBelow(const Key& hi) const
+{
+    Summary below = monoid_.identity();
+    for (Node<Key, Value>* n = this -> root_; n != NULL; ) {
+        if (n -> getKey() < hi) {
+            below = monoid_.combine(below, monoid_.combine(summaryOf(n -> getLeft()), measureOf(n)));
+            n = n -> getRight();
+        }
+        else {
+            n = n -> getLeft();
+        }
+    }
+    return below;
+}
+
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Summary
+AugmentedAVLTree<Key, Value, Monoid>::total() const
+{
+    return summaryOf(this -> root_);
+}
+
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::AugNode*
+AugmentedAVLTree<Key, Value, Monoid>::aug(Node<Key, Value>* n)
+{
+    return static_cast<AugNode*>(n);
+}
+
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Summary
+AugmentedAVLTree<Key, Value, Monoid>::summaryOf(Node<Key, Value>* n) const
+{
+    return (n == NULL) ? monoid_.identity() : aug(n) -> getSummary();
+}
+
+template<class Key, class Value, class Monoid>
+typename AugmentedAVLTree<Key, Value, Monoid>::Summary
+AugmentedAVLTree<Key, Value, Monoid>::measureOf(Node<Key, Value>* n) const
+{
+    return n -> isDead() ? monoid_.identity() : monoid_.measure(n -> getKey(), n -> getValue());
+}
+
+/**
+* Recomputes n's summary from its children's, which must be up to date.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::resummarize(Node<Key, Value>* n)
+{
+    aug(n) -> setSummary(monoid_.combine(monoid_.combine(summaryOf(n -> getLeft()), measureOf(n)),
+                                         summaryOf(n -> getRight())));
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::resummarizeAll(Node<Key, Value>* n)
+{
+    if (n == NULL) {
+        return;
+    }
+    resummarizeAll(n -> getLeft());
+    resummarizeAll(n -> getRight());
+    resummarize(n);
+}
+
+template<class Key, class Value, class Monoid>
+Node<Key, Value>* AugmentedAVLTree<Key, Value, Monoid>::makeNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    BST_COUNT(allocations);
+    return new AugNode(key, value, static_cast<AVLNode<Key, Value>*>(parent), monoid_.measure(key, value));
+}
+
+/**
+* Bulk builds link children before their parent, so the summary can be
+* computed here along with the balance.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::setBuiltHeights(Node<Key, Value>* n, int leftHeight, int rightHeight)
+{
+    AVLTree<Key, Value>::setBuiltHeights(n, leftHeight, rightHeight);
+    resummarize(n);
+}
+
+/**
+* A rotation only changes the subtrees of the two nodes it swaps: the
+* one moving down, then the one that took its place.
+*/
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::rotateRight(AVLNode<Key, Value>* node)
+{
+    AVLTree<Key, Value>::rotateRight(node);
+    resummarize(node);
+    resummarize(node -> getParent());
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::rotateLeft(AVLNode<Key, Value>* node)
+{
+    AVLTree<Key, Value>::rotateLeft(node);
+    resummarize(node);
+    resummarize(node -> getParent());
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::refreshPath(AVLNode<Key, Value>* n)
+{
+    for (; n != NULL; n = n -> getParent()) {
+        resummarize(n);
+    }
+}
+
+template<class Key, class Value, class Monoid>
+void AugmentedAVLTree<Key, Value, Monoid>::rejoined()
+{
+    resummarizeAll(this -> root_);
+}
+
+template<class Key, class Value, class Monoid>
+size_t AugmentedAVLTree<Key, Value, Monoid>::nodeBytes() const
+{
+    return sizeof(AugNode);
+}
+
+template<class Key, class Value, class Monoid>
+size_t AugmentedAVLTree<Key, Value, Monoid>::balanceBytes() const
+{
+    return AVLTree<Key, Value>::balanceBytes() + sizeof(Summary);
+}
+
+template<class Key, class Value, class Monoid>
+size_t AugmentedAVLTree<Key, Value, Monoid>::treeBytes() const
+{
+    return sizeof(*this);
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the AugmentedAVLTree class.
+  -------------------------------------------------
+*/
+
+#endif
@@ -5,7 +5,12 @@
 #include <exception>
 #include <cstdlib>
 #include <cstdint>
+#include <cmath>
+#include <stdexcept>
 #include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
 #include "bst.h"
 
 struct KeyError { };
@@ -35,8 +40,13 @@ public:
     virtual AVLNode<Key, Value>* getLeft() const override;
     virtual AVLNode<Key, Value>* getRight() const override;
 
+    // Tombstone flag for AVLTree's lazy deletion.
+    virtual bool isDead() const override;
+    void setDead(bool dead);
+
 protected:
     int8_t balance_;    // effectively a signed char
+    bool dead_;         // fits in the padding after balance_
 };
 
 /*
@@ -50,7 +60,7 @@ protected:
 */
 template<class Key, class Value>
 AVLNode<Key, Value>::AVLNode(const Key& key, const Value& value, AVLNode<Key, Value> *parent) :
-    Node<Key, Value>(key, value, parent), balance_(0)
+    Node<Key, Value>(key, value, parent), balance_(0), dead_(false)
 {
 
 }
@@ -119,6 +129,18 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
     return static_cast<AVLNode<Key, Value>*>(this->right_);
 }
 
+template<class Key, class Value>
+bool AVLNode<Key, Value>::isDead() const
+{
+    return dead_;
+}
+
+template<class Key, class Value>
+void AVLNode<Key, Value>::setDead(bool dead)
+{
+    dead_ = dead;
+}
+
 
 /*
   -----------------------------------------------
@@ -127,53 +149,222 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 */
 
 
+// Lazy deletion: compaction starts once this fraction of the nodes are
+// tombstones, and then purges up to AVL_COMPACT_STEP of them on every
+// insert or delete until none are left.
+#define AVL_COMPACT_DEAD_FRACTION 0.25
+#define AVL_COMPACT_STEP 2
+
+/**
+* Lazy deletion counters returned by AVLTree::compactionStats().
+*/
+struct AVLCompactionStats
+{
+    uint64_t tombstones;       // dead nodes in the tree right now
+    uint64_t lazyDeletes;      // nodes marked dead
+    uint64_t revived;          // tombstones reused by an insert of their key
+    uint64_t purged;           // dead nodes physically removed
+    uint64_t compactions;      // compaction passes, incremental or compact()
+};
+
+// height both inputs must reach before a set operation hands one
+// recursive subproblem to another thread (a few thousand nodes each)
+#define AVL_SETOP_FORK_HEIGHT 12
+
+/**
+* Value-merge policies for the set operations below. They are called
+* as merge(mine, theirs) for keys present in both trees and return the
+* value to keep. On large trees the calls come from several threads at
+* once, so a user-supplied merge must be safe to call concurrently
+* (no unsynchronised shared state); these two are stateless.
+*/
+struct KeepThis
+{
+    template<class Value>
+    Value operator()(const Value& mine, const Value& theirs) const { return mine; }
+};
+
+struct KeepOther
+{
+    template<class Value>
+    Value operator()(const Value& mine, const Value& theirs) const { return theirs; }
+};
+
 template <class Key, class Value>
 class AVLTree : public BinarySearchTree<Key, Value>
 {
 public:
-    virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
-    virtual void remove(const Key& key);  // TODO
+    AVLTree();
+
+    // Lazy deletion. While it is on, remove() and erase() only mark the
+    // node dead, O(log n) with no rotations; find() and iterators skip
+    // dead nodes and inserting a dead key reuses its node. compact()
+    // purges every tombstone at once in O(n).
+    void setLazyDelete(bool enabled);
+    void setCompactionThreshold(double deadFraction);
+    void compact();
+    AVLCompactionStats compactionStats() const;
+
+    // Join-based set operations. Nodes of other are moved into (or freed
+    // by) this tree, so other is left empty afterwards.
+    template<class Merge>
+    void union_with(AVLTree<Key, Value>& other, Merge merge);
+    void union_with(AVLTree<Key, Value>& other);
+    template<class Merge>
+    void intersect_with(AVLTree<Key, Value>& other, Merge merge);
+    void intersect_with(AVLTree<Key, Value>& other);
+    void difference(AVLTree<Key, Value>& other);
+
+    // Inserts a run of (key, value) pairs sorted by key; for repeated
+    // keys the last value wins, as with insert().
+    template<class ForwardIterator>
+    void insert_batch(ForwardIterator first, ForwardIterator last);
+
 protected:
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    virtual Node<Key, Value>* findOrInsert(const Key& key, const Value& value, bool& inserted);
+    AVLNode<Key, Value>* insertBelow(AVLNode<Key, Value>* start, const Key& key, const Value& value, bool& inserted);
+    virtual void eraseNode(Node<Key, Value>* node);
+    virtual void eraseRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    virtual void dropNodes(std::vector<Node<Key, Value>*>& keep, std::vector<Node<Key, Value>*>& doomed);
+    void removeNow(AVLNode<Key, Value>* n);
+    void compactStep();
+    AVLNode<Key, Value>* findAny(const Key& key) const;
     virtual void insert_fix (AVLNode<Key, Value>* p, AVLNode<Key, Value>* n); // TODO
     virtual void rotateRight(AVLNode<Key, Value>* node);
     virtual void rotateLeft(AVLNode<Key, Value>* node);
     virtual int ZZcheck(AVLNode<Key, Value>* g, AVLNode<Key, Value>* n);
     void removeFix(AVLNode<Key,Value>* n, int diff);
-		virtual int getHeight(AVLNode<Key,Value>* n);
-
+    virtual Node<Key, Value>* makeNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void setBuiltHeights(Node<Key, Value>* n, int leftHeight, int rightHeight);
+    virtual size_t nodeBytes() const;
+    virtual size_t balanceBytes() const;
+    virtual size_t treeBytes() const;
+    virtual bool rebalancesItself() const;
+
+    // Augmentation hooks (see AugmentedAVLTree). refreshPath() runs after
+    // n's item or children changed, from n up to the root, before any
+    // rotations; rejoined() runs after a split/join pass relinked the
+    // tree without going through the rotation hooks.
+    virtual void refreshPath(AVLNode<Key, Value>* n);
+    virtual void rejoined();
+
+    // Runs on both trees after a set operation, for trees that keep
+    // state beside their nodes (see BufferedAVLTree). Both trees'
+    // flushPending() runs before the set operation takes the nodes.
+    virtual void setOpDone();
+
+    enum SetOp { SETOP_UNION, SETOP_INTERSECT, SETOP_DIFFERENCE };
+
+    // Counts the helper threads a set operation may still start.
+    struct ForkBudget
+    {
+        explicit ForkBudget(int spare) : spare_(spare) { }
+        bool acquire();
+        void release();
+        std::atomic<int> spare_;
+    };
+
+    // Split/join helpers. AVLNodes only store a balance, so subtree
+    // heights are passed alongside the subtree roots.
+    static int subtreeHeight(AVLNode<Key, Value>* n);
+    static int leftHeight(AVLNode<Key, Value>* n, int h);
+    static int rightHeight(AVLNode<Key, Value>* n, int h);
+    static int link(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k, AVLNode<Key, Value>* r, int hr);
+    static AVLNode<Key, Value>* rotateLeftSub(AVLNode<Key, Value>* x, int hx, int& h);
+    static AVLNode<Key, Value>* rotateRightSub(AVLNode<Key, Value>* x, int hx, int& h);
+    static AVLNode<Key, Value>* joinRight(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k, AVLNode<Key, Value>* r, int hr, int& h);
+    static AVLNode<Key, Value>* joinLeft(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k, AVLNode<Key, Value>* r, int hr, int& h);
+    static AVLNode<Key, Value>* join(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k, AVLNode<Key, Value>* r, int hr, int& h);
+    static AVLNode<Key, Value>* join2(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* r, int hr, int& h);
+    static void split(AVLNode<Key, Value>* t, int ht, const Key& key,
+                      AVLNode<Key, Value>*& l, int& hl, AVLNode<Key, Value>*& m, AVLNode<Key, Value>*& r, int& hr);
+    static void splitLast(AVLNode<Key, Value>* t, int ht, AVLNode<Key, Value>*& rest, int& hrest, AVLNode<Key, Value>*& last);
+    static uint64_t freeSubtree(AVLNode<Key, Value>* n);
+    template<class Merge>
+    AVLNode<Key, Value>* setOpHelper(SetOp op, AVLNode<Key, Value>* a, int ha, AVLNode<Key, Value>* b, int hb,
+                                     int& h, const Merge& merge, ForkBudget& budget, std::atomic<uint64_t>& freed);
+    template<class Merge>
+    void runSetOp(SetOp op, AVLTree<Key, Value>& other, const Merge& merge);
+
+    // Lazy deletion state. size_ and dead_ (in BinarySearchTree) are only
+    // kept up to date while lazy_ is set. Keys of tombstones wait in
+    // deadKeys_ from deadHead_ on; keys whose node has since been revived
+    // or purged are skipped when their turn comes.
+    bool lazy_;
+    bool compacting_;
+    double compactThreshold_;
+    std::vector<Key> deadKeys_;
+    size_t deadHead_;
+    AVLCompactionStats compaction_;
+};
 
+template<class Key, class Value>
+AVLTree<Key, Value>::AVLTree() :
+    lazy_(false), compacting_(false), compactThreshold_(AVL_COMPACT_DEAD_FRACTION),
+    deadHead_(0), compaction_()
+{
 
-};
+}
 
 /*
  * Recall: If key is already in the tree, you should 
  * overwrite the current value with the updated value.
+ * (insert() itself is BinarySearchTree's, which does that on top of
+ * this lookup-or-insert.)
  */
 template<class Key, class Value>
-void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
+Node<Key, Value>* AVLTree<Key, Value>::findOrInsert(const Key& key, const Value& value, bool& inserted)
 {
-    if(BinarySearchTree<Key, Value>::empty()) {
-			this -> root_ = new AVLNode<Key, Value>(new_item.first, new_item.second, NULL);
+    return insertBelow(static_cast<AVLNode<Key, Value>*>(this -> root_), key, value, inserted);
+}
+
+/**
+* findOrInsert() with the descent starting at start instead of the root.
+* key must belong in start's subtree (insert_batch() makes sure of that).
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::insertBelow(AVLNode<Key, Value>* start, const Key& key, const Value& value, bool& inserted)
+{
+    inserted = true;
+    if(this -> root_ == NULL) {
+			this -> root_ = this -> makeNode(key, value, NULL);
+			this -> indexInsert(this -> root_);
 			AVLNode<Key, Value>* c = static_cast<AVLNode<Key, Value>*>(this -> root_);
 			c -> setBalance(0);
-			return;
+			refreshPath(c);
+			if (lazy_) {
+				this -> size_ = 1;
+			}
+			return c;
 		}
-    else {
-		AVLNode<Key, Value>* curr = static_cast<AVLNode<Key, Value>*> (this -> root_);
-		AVLNode<Key, Value>* curr_child = static_cast<AVLNode<Key, Value>*> (this -> root_);
+		AVLNode<Key, Value>* curr = start;
+		AVLNode<Key, Value>* curr_child = start;
 		while(curr != NULL ) {
-			if (new_item.first == curr -> getKey()) {
-				curr -> setValue(new_item.second);
-				return;
+			BST_COUNT(comparisons);
+			if (key == curr -> getKey()) {
+				if (curr -> isDead()) {
+					//reuse the tombstone as if it were a new node
+					curr -> setDead(false);
+					curr -> setValue(value);
+					refreshPath(curr);
+					--this -> dead_;
+					++compaction_.revived;
+					compactStep();
+					return curr;
+				}
+				inserted = false;
+				return curr;
 			}
 
-			else if (new_item.first < curr -> getKey()) {
+			else if (key < curr -> getKey()) {
 				if (curr -> getLeft() == NULL) {
-					AVLNode<Key, Value>* temp = new AVLNode<Key, Value>(new_item.first, new_item.second, curr);
+					AVLNode<Key, Value>* temp = static_cast<AVLNode<Key, Value>*>(this -> makeNode(key, value, curr));
 					curr -> setLeft(temp);
+					this -> indexInsert(temp);
 					curr_child = curr -> getLeft();
 					curr_child -> setBalance(0);
+					refreshPath(curr_child);
 					break;
 				}
 				else {
@@ -181,12 +372,14 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
 				}
 			}
 
-			else if (new_item.first > curr -> getKey()) {
+			else {
 				if(curr -> getRight() == NULL ) {
-					AVLNode<Key, Value>* temp = new AVLNode<Key, Value>(new_item.first, new_item.second, curr);
+					AVLNode<Key, Value>* temp = static_cast<AVLNode<Key, Value>*>(this -> makeNode(key, value, curr));
 					curr -> setRight(temp);
+					this -> indexInsert(temp);
 					curr_child = curr -> getRight();
 					curr_child -> setBalance(0);
+					refreshPath(curr_child);
 					break;
 				}
 				else {
@@ -196,8 +389,6 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
 			}
 		}
 
-		/*if ( curr -> getParent() && curr -> getParent() -> getParent() && curr -> getParent() -> getParent() -> getLeft()) {
-		std:: cout << int(curr -> getParent() -> getParent() -> getLeft() -> getBalance()) << std::endl;}*/
     if (curr -> getBalance() == -1 ) {
         curr -> setBalance(0);
     }
@@ -213,10 +404,11 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
         }
         insert_fix(curr, curr_child);
     }
+    if (lazy_) {
+        ++this -> size_;
+        compactStep();
     }
-
-	BinarySearchTree<Key, Value>::printRoot(this -> root_);
-    
+    return curr_child;
 }
 
 template<class Key, class Value>
@@ -236,11 +428,13 @@ if (p == p -> getParent() -> getLeft()) {
 
     if (g -> getBalance() == -2) {
         if (ZZcheck(g, n) == 1) {
+        BST_COUNT(singleRotations);
         rotateRight(g);
         p -> setBalance(0);
         g -> setBalance(0);
         }
         else {
+            BST_COUNT(doubleRotations);
             rotateLeft(p);
             rotateRight(g);
 						if (n -> getBalance() == -1 ) {
@@ -274,11 +468,13 @@ else if (p == p -> getParent() -> getRight()) {
 
     if (g -> getBalance() == 2 ) {
         if (ZZcheck(g, n) == 1) {
+            BST_COUNT(singleRotations);
             rotateLeft(g);
             p -> setBalance(0);
             g -> setBalance(0);
         }
         else {
+            BST_COUNT(doubleRotations);
             rotateRight(p);
             rotateLeft(g);
 						if (n -> getBalance() == 1 ) {
@@ -417,29 +613,42 @@ void AVLTree<Key, Value> :: rotateLeft(AVLNode<Key, Value>* node) {
 /*
  * Recall: The writeup specifies that if a node has 2 children you
  * should swap with the predecessor and then remove.
+ * (remove() itself is BinarySearchTree's, which finds the node and
+ * hands it to this.)
  */
 template<class Key, class Value>
-void AVLTree<Key, Value>:: remove(const Key& key)
+void AVLTree<Key, Value>::eraseNode(Node<Key, Value>* node)
 {
+    AVLNode<Key, Value>* n = static_cast<AVLNode<Key, Value>*>(node);
+    if (!lazy_) {
+        removeNow(n);
+        return;
+    }
+    n -> setDead(true);
+    refreshPath(n);
+    ++this -> dead_;
+    ++compaction_.lazyDeletes;
+    deadKeys_.push_back(n -> getKey());
+    // also start when most queued keys are stale (revived), so the
+    // queue cannot grow without bound
+    if (!compacting_ && (this -> dead_ > compactThreshold_ * this -> size_ ||
+                         deadKeys_.size() - deadHead_ > 2 * this -> dead_ + AVL_COMPACT_STEP)) {
+        compacting_ = true;
+        ++compaction_.compactions;
+    }
+    compactStep();
+}
 
-	if(this -> root_ == NULL) {
-		return;
-	}
-  AVLNode<Key, Value>* n = static_cast<AVLNode<Key, Value>*> (BinarySearchTree<Key, Value>::internalFind(key));
-	if (n == NULL) {
-		return;
-	}
-		
+/**
+* Unlinks and frees n right away, rebalancing on the way up.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::removeNow(AVLNode<Key, Value>* n)
+{
   if (n -> getRight() != NULL && n -> getLeft() != NULL) {
     nodeSwap(n, static_cast<AVLNode<Key, Value>*>(BinarySearchTree<Key, Value>::predecessor(n)));
   }
 
-	if(n == this -> root_) {
-		delete n;
-		this -> root_ = NULL;
-		return;
-	}
-
     AVLNode<Key, Value>* p = n -> getParent();
     int diff = 0;
     if (p != NULL ) {
@@ -451,24 +660,27 @@ void AVLTree<Key, Value>:: remove(const Key& key)
         }
     }
 
-    if (n -> getLeft() == NULL && n -> getRight() == NULL) { 
-			if(n == n -> getParent() -> getLeft()) {
-				(n -> getParent()) -> setLeft(NULL);
-				delete n;
-			}
-			//delete and change if Node is a right child
-			else if(n == n -> getParent() -> getRight()) {
-				n -> getParent() -> setRight(NULL);
-				delete n;
-			}
+		//n has at most one child now, promote it into n's place
+		AVLNode<Key, Value>* child = (n -> getLeft() != NULL) ? n -> getLeft() : n -> getRight();
+		if (child != NULL) {
+			child -> setParent(p);
 		}
-
+		if (p == NULL) {
+			this -> root_ = child;
+		}
+		else if (diff == 1) {
+			p -> setLeft(child);
+		}
+		else {
+			p -> setRight(child);
+		}
+		this -> indexErase(n);
+		delete n;
+		BST_COUNT(frees);
+		// covers the nodeSwap() above too: both swapped nodes are on this path
+		refreshPath(p);
 
     removeFix(p, diff);
-
-	BinarySearchTree<Key, Value>::printRoot(this -> root_);
-
-
 }
 
 template<class Key, class Value>
@@ -477,28 +689,25 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key,Value>* n, int diff) {
         return;
     }
 
+		//direction for the next level up, taken before any rotation moves n
 		int ndiff = 0;
 		AVLNode<Key,Value>* p = n -> getParent();
 
-		if (n != this -> root_ && p != this -> root_) {
-			if (p == p -> getParent() -> getLeft()) {
-				ndiff = 1; 
+		if (p != NULL) {
+			if (n == p -> getLeft()) {
+				ndiff = 1;
 			}
-
-			if (p == p -> getParent() -> getRight()) {
+			else {
 				ndiff = -1;
 			}
 		}
 
 		if (diff == -1 ) {
 			if (n -> getBalance() + diff == -2) {
-				AVLNode<Key,Value>* c;
-				if (getHeight(n -> getLeft()) > getHeight( n -> getRight())) {
-				 	c = n -> getLeft(); }
-				else {
-					 c = n -> getRight();
-				}
+				//the left side is the taller one
+				AVLNode<Key,Value>* c = n -> getLeft();
 				if (c -> getBalance() == -1 ) {
+					BST_COUNT(singleRotations);
 					rotateRight(n);
 					c -> setBalance(0);
 					n -> setBalance(0);
@@ -506,6 +715,7 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key,Value>* n, int diff) {
 				}
 
 				else if (c -> getBalance() == 0) {
+					BST_COUNT(singleRotations);
 					rotateRight(n);
 					n -> setBalance(-1);
 					c -> setBalance(1);
@@ -515,6 +725,7 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key,Value>* n, int diff) {
 				else if (c -> getBalance() == 1){
 					AVLNode<Key,Value>* g = c -> getRight();
 					int g_balance = g -> getBalance();
+					BST_COUNT(doubleRotations);
 					rotateLeft(c);
 					rotateRight(n);
 					if (g_balance == 1) {
@@ -542,18 +753,16 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key,Value>* n, int diff) {
 
 			else if (n -> getBalance() + diff == 0) {
 				n -> setBalance(0);
+				removeFix(p, ndiff);
 			}
 		}
 
 		else if (diff == 1) {
 			if (n -> getBalance() + diff == 2) {
-				AVLNode<Key,Value>* c;
-				if (getHeight(n -> getLeft()) > getHeight( n -> getRight())) {
-				 	c = n -> getLeft(); }
-				else {
-					 c = n -> getRight();
-				}
+				//the right side is the taller one
+				AVLNode<Key,Value>* c = n -> getRight();
 				if (c -> getBalance() == 1 ) {
+					BST_COUNT(singleRotations);
 					rotateLeft(n);
 					c -> setBalance(0);
 					n -> setBalance(0);
@@ -561,6 +770,7 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key,Value>* n, int diff) {
 				}
 
 				else if (c -> getBalance() == 0) {
+					BST_COUNT(singleRotations);
 					rotateLeft(n);
 					n -> setBalance(1);
 					c -> setBalance(-1);
@@ -570,6 +780,7 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key,Value>* n, int diff) {
 				else if (c -> getBalance() == -1){
 					AVLNode<Key,Value>* g = c -> getLeft();
 					int g_balance = g -> getBalance();
+					BST_COUNT(doubleRotations);
 					rotateRight(c);
 					rotateLeft(n);
 					if (g_balance == -1) {
@@ -597,25 +808,69 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key,Value>* n, int diff) {
 
 			else if (n -> getBalance() + diff == 0) {
 				n -> setBalance(0);
+				removeFix(p, ndiff);
 			}
 
 		}
     
 }
+/**
+* Bulk-built AVL trees are made of AVLNodes.
+*/
 template<class Key, class Value>
-int AVLTree<Key, Value>:: getHeight(AVLNode<Key,Value>* n) {
-	if (n == NULL) {
-		return 0;
-	}
-	if (getHeight(n -> getLeft()) > getHeight( n -> getRight())) {
-		return 1 + getHeight(n -> getLeft());
-	}
-	else {
-		return 1 + getHeight( n -> getRight());
-		 }
+Node<Key, Value>* AVLTree<Key, Value>::makeNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    BST_COUNT(allocations);
+    return new AVLNode<Key, Value>(key, value, static_cast<AVLNode<Key, Value>*>(parent));
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::setBuiltHeights(Node<Key, Value>* n, int leftHeight, int rightHeight)
+{
+    static_cast<AVLNode<Key, Value>*>(n) -> setBalance(rightHeight - leftHeight);
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::refreshPath(AVLNode<Key, Value>* n)
+{
+
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::rejoined()
+{
 
 }
 
+template<class Key, class Value>
+void AVLTree<Key, Value>::setOpDone()
+{
+
+}
+
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::nodeBytes() const
+{
+    return sizeof(AVLNode<Key, Value>);
+}
+
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::balanceBytes() const
+{
+    return sizeof(int8_t) + sizeof(bool);
+}
+
+template<class Key, class Value>
+size_t AVLTree<Key, Value>::treeBytes() const
+{
+    return sizeof(*this);
+}
+
+template<class Key, class Value>
+bool AVLTree<Key, Value>::rebalancesItself() const
+{
+    return true;
+}
 
 template<class Key, class Value>
 void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
@@ -627,4 +882,728 @@ void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>*
 }
 
 
+/*
+  -----------------------------------------------
+  Begin lazy deletion.
+  -----------------------------------------------
+*/
+
+/**
+* Turns lazy deletion on or off. Turning it off compacts first, so an
+* eager tree never holds tombstones.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::setLazyDelete(bool enabled)
+{
+    if (!enabled) {
+        if (lazy_) {
+            compact();
+        }
+        lazy_ = false;
+        return;
+    }
+    lazy_ = true;
+    uint64_t count = 0;
+    for (Node<Key, Value>* n = this -> getSmallestNode(); n != NULL; n = BinarySearchTree<Key, Value>::successor(n)) {
+        ++count;
+    }
+    this -> size_ = count;
+    this -> maxSize_ = count;
+}
+
+/**
+* Sets the fraction of dead nodes (0 to 1) at which incremental
+* compaction starts. 0 purges tombstones as soon as the next operation.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::setCompactionThreshold(double deadFraction)
+{
+    compactThreshold_ = deadFraction;
+}
+
+/**
+* Frees every tombstone and relinks the live nodes perfectly balanced,
+* O(n) with no rotations.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::compact()
+{
+    this -> flushPending();
+    if (this -> dead_ > 0) {
+        std::vector<Node<Key, Value>*> live;
+        std::vector<Node<Key, Value>*> dead;
+        for (Node<Key, Value>* n = this -> getSmallestNode(); n != NULL; n = BinarySearchTree<Key, Value>::successor(n)) {
+            (n -> isDead() ? dead : live).push_back(n);
+        }
+        for (size_t i = 0; i < dead.size(); ++i) {
+            delete dead[i];
+            BST_COUNT(frees);
+        }
+        this -> relinkAll(live);
+        compaction_.purged += dead.size();
+        ++compaction_.compactions;
+        this -> dead_ = 0;
+    }
+    deadKeys_.clear();
+    deadHead_ = 0;
+    compacting_ = false;
+}
+
+template<class Key, class Value>
+AVLCompactionStats AVLTree<Key, Value>::compactionStats() const
+{
+    AVLCompactionStats stats = compaction_;
+    stats.tombstones = this -> dead_;
+    return stats;
+}
+
+/**
+* Purges up to AVL_COMPACT_STEP queued tombstones while a compaction
+* pass is running, so no single operation pays for more than a few
+* ordinary removes.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::compactStep()
+{
+    if (!compacting_) {
+        return;
+    }
+    for (int i = 0; i < AVL_COMPACT_STEP && deadHead_ < deadKeys_.size(); ++i) {
+        AVLNode<Key, Value>* n = findAny(deadKeys_[deadHead_++]);
+        if (n != NULL && n -> isDead()) {
+            removeNow(n);
+            --this -> dead_;
+            --this -> size_;
+            ++compaction_.purged;
+        }
+    }
+    if (deadHead_ == deadKeys_.size() || this -> dead_ == 0) {
+        deadKeys_.clear();
+        deadHead_ = 0;
+        compacting_ = false;
+    }
+}
+
+/**
+* Like internalFind(), but also returns tombstones.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::findAny(const Key& key) const
+{
+    AVLNode<Key, Value>* curr = static_cast<AVLNode<Key, Value>*>(this -> root_);
+    while (curr != NULL && !(curr -> getKey() == key)) {
+        curr = (key < curr -> getKey()) ? curr -> getLeft() : curr -> getRight();
+    }
+    return curr;
+}
+
+/**
+* erase_if()'s bulk path: with lazy deletion the doomed nodes are only
+* marked dead, like every other delete.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::dropNodes(std::vector<Node<Key, Value>*>& keep, std::vector<Node<Key, Value>*>& doomed)
+{
+    if (!lazy_) {
+        BinarySearchTree<Key, Value>::dropNodes(keep, doomed);
+        return;
+    }
+    for (size_t i = 0; i < doomed.size(); ++i) {
+        eraseNode(doomed[i]);
+    }
+}
+
+/*
+  -----------------------------------------------
+  End lazy deletion.
+  -----------------------------------------------
+*/
+
+
+/*
+  -----------------------------------------------
+  Begin join-based set operations.
+  -----------------------------------------------
+*/
+
+/**
+* Union: every key of either tree ends up in this tree. For keys present
+* in both, the stored value is merge(this value, other value). merge may
+* be called from helper threads concurrently (see runSetOp()).
+*/
+template<class Key, class Value>
+template<class Merge>
+void AVLTree<Key, Value>::union_with(AVLTree<Key, Value>& other, Merge merge)
+{
+    runSetOp(SETOP_UNION, other, merge);
+}
+
+/**
+* Union where other's value wins, matching what insert() would do.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::union_with(AVLTree<Key, Value>& other)
+{
+    runSetOp(SETOP_UNION, other, KeepOther());
+}
+
+/**
+* Intersection: only keys present in both trees are kept, with the
+* value merge(this value, other value). merge may be called from helper
+* threads concurrently (see runSetOp()).
+*/
+template<class Key, class Value>
+template<class Merge>
+void AVLTree<Key, Value>::intersect_with(AVLTree<Key, Value>& other, Merge merge)
+{
+    runSetOp(SETOP_INTERSECT, other, merge);
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::intersect_with(AVLTree<Key, Value>& other)
+{
+    runSetOp(SETOP_INTERSECT, other, KeepOther());
+}
+
+/**
+* Difference: removes every key of other from this tree.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::difference(AVLTree<Key, Value>& other)
+{
+    runSetOp(SETOP_DIFFERENCE, other, KeepThis());
+}
+
+/**
+* Walks the tree and the batch together: each key is inserted starting
+* from the node of the key before it, climbing only until the subtree
+* there spans the new key. A batch of keys that are d apart in the tree
+* costs O(log d) per key instead of a full descent each, and the upper
+* levels are only visited once per run of nearby keys. An empty tree is
+* linked straight from the batch in O(m).
+*
+* Throws std::invalid_argument, before inserting anything, if the keys
+* are not sorted.
+*/
+template<class Key, class Value>
+template<class ForwardIterator>
+void AVLTree<Key, Value>::insert_batch(ForwardIterator first, ForwardIterator last)
+{
+    for (ForwardIterator it = first, prev = first; it != last; prev = it++) {
+        if (it != first && it -> first < prev -> first) {
+            throw std::invalid_argument("insert_batch: keys out of order");
+        }
+    }
+
+    if (this -> root_ == NULL) {
+        std::vector<Node<Key, Value>*> nodes;
+        for (; first != last; ++first) {
+            if (!nodes.empty() && nodes.back() -> getKey() == first -> first) {
+                nodes.back() -> setValue(first -> second);
+            }
+            else {
+                nodes.push_back(this -> makeNode(first -> first, first -> second, NULL));
+            }
+        }
+        this -> relinkAll(nodes);
+        return;
+    }
+
+    AVLNode<Key, Value>* finger = static_cast<AVLNode<Key, Value>*>(this -> root_);
+    for (; first != last; ++first) {
+        const Key& key = first -> first;
+        // climb while the finger's subtree ends below key; key is never
+        // below it, since the batch is sorted
+        while (finger -> getParent() != NULL &&
+               !(finger == finger -> getParent() -> getLeft() && key < finger -> getParent() -> getKey())) {
+            finger = finger -> getParent();
+        }
+        bool inserted;
+        finger = insertBelow(finger, key, first -> second, inserted);
+        if (!inserted) {
+            finger -> setValue(first -> second);
+            refreshPath(finger);
+        }
+    }
+}
+
+/**
+* Detaches both trees and runs the recursive set operation on them,
+* allowing up to hardware_concurrency() - 1 helper threads.
+*
+* Each fork starts its own std::thread rather than handing work to a
+* thread pool. The forking thread blocks in join() on its half, so a
+* fixed pool would need work stealing to avoid every worker waiting on
+* queued children; and the header has no owner to keep a pool alive
+* between calls. Forks only happen on subtrees of height
+* AVL_SETOP_FORK_HEIGHT or more, so starting a thread is small next to
+* the work it does, and ForkBudget caps how many run at once.
+*/
+template<class Key, class Value>
+template<class Merge>
+void AVLTree<Key, Value>::runSetOp(SetOp op, AVLTree<Key, Value>& other, const Merge& merge)
+{
+    if (&other == this) {
+        if (op == SETOP_DIFFERENCE) {
+            this -> clear();
+        }
+        return;
+    }
+    this -> flushPending();
+    other.flushPending();
+
+    // the recursion compares keys only, so tombstones must go first
+    if (this -> dead_ > 0) {
+        compact();
+    }
+    if (other.dead_ > 0) {
+        other.compact();
+    }
+
+    AVLNode<Key, Value>* a = static_cast<AVLNode<Key, Value>*>(this -> root_);
+    AVLNode<Key, Value>* b = static_cast<AVLNode<Key, Value>*>(other.root_);
+    other.root_ = NULL;
+    other.size_ = 0;
+
+    int threads = (int)std::thread::hardware_concurrency();
+    ForkBudget budget(threads > 1 ? threads - 1 : 0);
+    std::atomic<uint64_t> freed(0);
+    int h = 0;
+    AVLNode<Key, Value>* result = setOpHelper(op, a, subtreeHeight(a), b, subtreeHeight(b), h, merge, budget, freed);
+    if (result != NULL) {
+        result -> setParent(NULL);
+    }
+#ifdef BST_STATS
+    // the helper threads are done, so the stats can be touched again
+    this -> stats_.frees += freed.load();
+#endif
+    this -> root_ = result;
+    rejoined();
+    // nodes moved between the trees or were freed by the recursion
+    this -> reindex();
+    other.reindex();
+    if (lazy_) {
+        setLazyDelete(true);
+    }
+    setOpDone();
+    other.setOpDone();
+}
+
+/**
+* Splits b around the root key of a, solves the two halves (in parallel
+* when they are large enough) and joins the results back together with
+* a's root. This gives the O(m log(n/m + 1)) work bound.
+*
+* This may run on a helper thread, so it must not touch the tree's
+* stats; the nodes it frees are tallied in freed instead.
+*/
+template<class Key, class Value>
+template<class Merge>
+AVLNode<Key, Value>* AVLTree<Key, Value>::setOpHelper(SetOp op, AVLNode<Key, Value>* a, int ha,
+    AVLNode<Key, Value>* b, int hb, int& h, const Merge& merge, ForkBudget& budget, std::atomic<uint64_t>& freed)
+{
+    if (a == NULL) {
+        if (op == SETOP_UNION) {
+            h = hb;
+            return b;
+        }
+        freed.fetch_add(freeSubtree(b), std::memory_order_relaxed);
+        h = 0;
+        return NULL;
+    }
+    if (b == NULL) {
+        if (op == SETOP_INTERSECT) {
+            freed.fetch_add(freeSubtree(a), std::memory_order_relaxed);
+            h = 0;
+            return NULL;
+        }
+        h = ha;
+        return a;
+    }
+
+    AVLNode<Key, Value>* bl; int hbl;
+    AVLNode<Key, Value>* m;
+    AVLNode<Key, Value>* br; int hbr;
+    split(b, hb, a -> getKey(), bl, hbl, m, br, hbr);
+
+    AVLNode<Key, Value>* al = a -> getLeft();
+    AVLNode<Key, Value>* ar = a -> getRight();
+    int hal = leftHeight(a, ha);
+    int har = rightHeight(a, ha);
+
+    AVLNode<Key, Value>* l; int hl = 0;
+    AVLNode<Key, Value>* r; int hr = 0;
+    std::thread worker;
+    if (ha >= AVL_SETOP_FORK_HEIGHT && hb >= AVL_SETOP_FORK_HEIGHT && budget.acquire()) {
+        try {
+            worker = std::thread([&]() {
+                l = setOpHelper(op, al, hal, bl, hbl, hl, merge, budget, freed);
+            });
+        }
+        catch (const std::system_error&) {
+            // both trees are already split up here, so rather than
+            // unwinding, give the slot back and recurse serially
+            budget.release();
+        }
+    }
+    if (worker.joinable()) {
+        r = setOpHelper(op, ar, har, br, hbr, hr, merge, budget, freed);
+        worker.join();
+        budget.release();
+    }
+    else {
+        l = setOpHelper(op, al, hal, bl, hbl, hl, merge, budget, freed);
+        r = setOpHelper(op, ar, har, br, hbr, hr, merge, budget, freed);
+    }
+
+    //keep a's root as the middle key unless the operation drops it
+    bool keep = (op == SETOP_UNION) || ((m != NULL) == (op == SETOP_INTERSECT));
+    if (m != NULL) {
+        if (keep) {
+            a -> setValue(merge(a -> getValue(), m -> getValue()));
+        }
+        delete m;
+        freed.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (keep) {
+        return join(l, hl, a, r, hr, h);
+    }
+    delete a;
+    freed.fetch_add(1, std::memory_order_relaxed);
+    return join2(l, hl, r, hr, h);
+}
+
+template<class Key, class Value>
+bool AVLTree<Key, Value>::ForkBudget::acquire()
+{
+    int spare = spare_.load();
+    while (spare > 0) {
+        if (spare_.compare_exchange_weak(spare, spare - 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class Key, class Value>
+void AVLTree<Key, Value>::ForkBudget::release()
+{
+    spare_.fetch_add(1);
+}
+
+/**
+* Height of a subtree in O(log n), found by always stepping into the
+* taller child according to the balance.
+*/
+template<class Key, class Value>
+int AVLTree<Key, Value>::subtreeHeight(AVLNode<Key, Value>* n)
+{
+    int h = 0;
+    while (n != NULL) {
+        h++;
+        n = (n -> getBalance() > 0) ? n -> getRight() : n -> getLeft();
+    }
+    return h;
+}
+
+/**
+* Height of the left subtree of n, given that n has height h.
+*/
+template<class Key, class Value>
+int AVLTree<Key, Value>::leftHeight(AVLNode<Key, Value>* n, int h)
+{
+    int b = n -> getBalance();
+    return h - 1 - (b > 0 ? b : 0);
+}
+
+/**
+* Height of the right subtree of n, given that n has height h.
+*/
+template<class Key, class Value>
+int AVLTree<Key, Value>::rightHeight(AVLNode<Key, Value>* n, int h)
+{
+    int b = n -> getBalance();
+    return h - 1 + (b < 0 ? b : 0);
+}
+
+/**
+* Makes l and r the children of k, sets k's balance and returns the
+* height of the new subtree. k's own parent is left to the caller.
+*/
+template<class Key, class Value>
+int AVLTree<Key, Value>::link(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k, AVLNode<Key, Value>* r, int hr)
+{
+    k -> setLeft(l);
+    k -> setRight(r);
+    if (l != NULL) {
+        l -> setParent(k);
+    }
+    if (r != NULL) {
+        r -> setParent(k);
+    }
+    k -> setBalance(hr - hl);
+    return (hl > hr ? hl : hr) + 1;
+}
+
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::rotateLeftSub(AVLNode<Key, Value>* x, int hx, int& h)
+{
+    AVLNode<Key, Value>* y = x -> getRight();
+    int hy = rightHeight(x, hx);
+    AVLNode<Key, Value>* a = x -> getLeft();
+    int ha = leftHeight(x, hx);
+    AVLNode<Key, Value>* b = y -> getLeft();
+    int hb = leftHeight(y, hy);
+    AVLNode<Key, Value>* c = y -> getRight();
+    int hc = rightHeight(y, hy);
+    int hx2 = link(a, ha, x, b, hb);
+    h = link(x, hx2, y, c, hc);
+    return y;
+}
+
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::rotateRightSub(AVLNode<Key, Value>* x, int hx, int& h)
+{
+    AVLNode<Key, Value>* y = x -> getLeft();
+    int hy = leftHeight(x, hx);
+    AVLNode<Key, Value>* a = y -> getLeft();
+    int ha = leftHeight(y, hy);
+    AVLNode<Key, Value>* b = y -> getRight();
+    int hb = rightHeight(y, hy);
+    AVLNode<Key, Value>* c = x -> getRight();
+    int hc = rightHeight(x, hx);
+    int hx2 = link(b, hb, x, c, hc);
+    h = link(a, ha, y, x, hx2);
+    return y;
+}
+
+/**
+* Joins l < k < r when l is more than one level taller than r by walking
+* down l's right spine until the heights match.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::joinRight(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k,
+    AVLNode<Key, Value>* r, int hr, int& h)
+{
+    AVLNode<Key, Value>* a = l -> getLeft();
+    int ha = leftHeight(l, hl);
+    AVLNode<Key, Value>* c = l -> getRight();
+    int hc = rightHeight(l, hl);
+
+    AVLNode<Key, Value>* t;
+    int ht;
+    if (hc <= hr + 1) {
+        ht = link(c, hc, k, r, hr);
+        t = k;
+        if (ht > ha + 1) {
+            t = rotateRightSub(t, ht, ht);
+        }
+    }
+    else {
+        t = joinRight(c, hc, k, r, hr, ht);
+    }
+    h = link(a, ha, l, t, ht);
+    if (ht > ha + 1) {
+        return rotateLeftSub(l, h, h);
+    }
+    return l;
+}
+
+/**
+* Mirror image of joinRight for when r is the taller tree.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::joinLeft(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k,
+    AVLNode<Key, Value>* r, int hr, int& h)
+{
+    AVLNode<Key, Value>* c = r -> getLeft();
+    int hc = leftHeight(r, hr);
+    AVLNode<Key, Value>* b = r -> getRight();
+    int hb = rightHeight(r, hr);
+
+    AVLNode<Key, Value>* t;
+    int ht;
+    if (hc <= hl + 1) {
+        ht = link(l, hl, k, c, hc);
+        t = k;
+        if (ht > hb + 1) {
+            t = rotateLeftSub(t, ht, ht);
+        }
+    }
+    else {
+        t = joinLeft(l, hl, k, c, hc, ht);
+    }
+    h = link(t, ht, r, b, hb);
+    if (ht > hb + 1) {
+        return rotateRightSub(r, h, h);
+    }
+    return r;
+}
+
+/**
+* Joins two AVL subtrees with every key in l < k->getKey() < every key in r.
+* Runs in O(|hl - hr| + 1).
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::join(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* k,
+    AVLNode<Key, Value>* r, int hr, int& h)
+{
+    if (hl > hr + 1) {
+        return joinRight(l, hl, k, r, hr, h);
+    }
+    if (hr > hl + 1) {
+        return joinLeft(l, hl, k, r, hr, h);
+    }
+    h = link(l, hl, k, r, hr);
+    return k;
+}
+
+/**
+* Joins two subtrees without a middle key by pulling the largest node out of l.
+*/
+template<class Key, class Value>
+AVLNode<Key, Value>* AVLTree<Key, Value>::join2(AVLNode<Key, Value>* l, int hl, AVLNode<Key, Value>* r, int hr, int& h)
+{
+    if (l == NULL) {
+        h = hr;
+        return r;
+    }
+    AVLNode<Key, Value>* rest;
+    int hrest;
+    AVLNode<Key, Value>* last;
+    splitLast(l, hl, rest, hrest, last);
+    return join(rest, hrest, last, r, hr, h);
+}
+
+/**
+* Splits t into the keys less than key (l), the node holding key if
+* there is one (m) and the keys greater than key (r).
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::split(AVLNode<Key, Value>* t, int ht, const Key& key,
+    AVLNode<Key, Value>*& l, int& hl, AVLNode<Key, Value>*& m, AVLNode<Key, Value>*& r, int& hr)
+{
+    if (t == NULL) {
+        l = m = r = NULL;
+        hl = hr = 0;
+        return;
+    }
+    AVLNode<Key, Value>* tl = t -> getLeft();
+    int htl = leftHeight(t, ht);
+    AVLNode<Key, Value>* tr = t -> getRight();
+    int htr = rightHeight(t, ht);
+
+    if (key == t -> getKey()) {
+        l = tl;
+        hl = htl;
+        r = tr;
+        hr = htr;
+        m = t;
+        m -> setLeft(NULL);
+        m -> setRight(NULL);
+    }
+    else if (key < t -> getKey()) {
+        AVLNode<Key, Value>* mid;
+        int hmid;
+        split(tl, htl, key, l, hl, m, mid, hmid);
+        r = join(mid, hmid, t, tr, htr, hr);
+    }
+    else {
+        AVLNode<Key, Value>* mid;
+        int hmid;
+        split(tr, htr, key, mid, hmid, m, r, hr);
+        l = join(tl, htl, t, mid, hmid, hl);
+    }
+}
+
+/**
+* Removes the largest node of t, returning it in last and the remaining tree in rest.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::splitLast(AVLNode<Key, Value>* t, int ht, AVLNode<Key, Value>*& rest, int& hrest,
+    AVLNode<Key, Value>*& last)
+{
+    if (t -> getRight() == NULL) {
+        rest = t -> getLeft();
+        hrest = leftHeight(t, ht);
+        last = t;
+        last -> setLeft(NULL);
+        return;
+    }
+    AVLNode<Key, Value>* mid;
+    int hmid;
+    splitLast(t -> getRight(), rightHeight(t, ht), mid, hmid, last);
+    rest = join(t -> getLeft(), leftHeight(t, ht), t, mid, hmid, hrest);
+}
+
+/**
+* Deletes the subtree rooted at n and returns how many nodes it held.
+* Unlike clearHelper() it leaves the stats alone, since set operations
+* call it from helper threads.
+*/
+template<class Key, class Value>
+uint64_t AVLTree<Key, Value>::freeSubtree(AVLNode<Key, Value>* n)
+{
+    if (n == NULL) {
+        return 0;
+    }
+    uint64_t count = 1 + freeSubtree(n -> getLeft()) + freeSubtree(n -> getRight());
+    delete n;
+    return count;
+}
+
+/**
+* Cuts [first, last) out with two splits and one join, O(log n) plus
+* freeing the removed nodes, instead of one rebalancing delete per node.
+*/
+template<class Key, class Value>
+void AVLTree<Key, Value>::eraseRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    if (lazy_) {
+        // splitting would free tombstones in the range behind dead_'s back
+        BinarySearchTree<Key, Value>::eraseRange(first, last);
+        return;
+    }
+    AVLNode<Key, Value>* root = static_cast<AVLNode<Key, Value>*>(this -> root_);
+    AVLNode<Key, Value>* l;
+    AVLNode<Key, Value>* m;
+    AVLNode<Key, Value>* r;
+    int hl, hr;
+    split(root, subtreeHeight(root), first -> getKey(), l, hl, m, r, hr);
+    // m is first; the rest of the range is the part of r below last
+    AVLNode<Key, Value>* doomed = r;
+    AVLNode<Key, Value>* kept = NULL;
+    int hkept = 0;
+    if (last != NULL) {
+        AVLNode<Key, Value>* lastNode;
+        AVLNode<Key, Value>* above;
+        int hdoomed, habove;
+        split(r, hr, last -> getKey(), doomed, hdoomed, lastNode, above, habove);
+        kept = join(NULL, 0, lastNode, above, habove, hkept);
+    }
+    this -> indexErase(m);
+    delete m;
+    BST_COUNT(frees);
+    if (doomed != NULL) {
+        doomed -> setParent(NULL);
+    }
+    this -> indexEraseSubtree(doomed);
+    this -> clearHelper(doomed);
+
+    int h;
+    AVLNode<Key, Value>* result = join2(l, hl, kept, hkept, h);
+    if (result != NULL) {
+        result -> setParent(NULL);
+    }
+    this -> root_ = result;
+    rejoined();
+}
+
+/*
+  -----------------------------------------------
+  End join-based set operations.
+  -----------------------------------------------
+*/
+
+
 #endif
@@ -0,0 +1,216 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// A key sets and tests bits in a single block, one 64-byte cache line.
+#define BLOOM_BLOCK_WORDS 8
+#define BLOOM_BLOCK_BITS (BLOOM_BLOCK_WORDS * 64)
+// Extra bits per key over the textbook sizing, as a share of it per
+// decade of false positive rate. The textbook sizing assumes the bits
+// are spread over the whole filter; keeping them in one block makes some
+// blocks fuller than average, which costs more the more probes there
+// are. 0.15 keeps a full filter within its rate from 5% down to 0.1%.
+#define BLOOM_BLOCK_OVERHEAD 0.15
+// A rebuild sizes the filter for twice the keys it holds, and never for
+// fewer than this many.
+#define BLOOM_MIN_KEYS 1024
+// Removed keys keep their bits; once they reach this share of the keys
+// added, the next insert rebuilds the filter.
+#define BLOOM_MAX_STALE 0.5
+
+/**
+* Approximate key set that a tree keeps beside itself (see
+* BinarySearchTree::enableBloomFilter()). mayContain() never returns
+* false for a key that was inserted. As with NodeIndexBase, the tree
+* only sees this interface, so only filtered trees need a hash.
+*/
+template <typename Key>
+class KeyFilterBase
+{
+public:
+    virtual ~KeyFilterBase() { }
+
+    virtual bool mayContain(const Key& key) const = 0;
+    virtual void insert(const Key& key) = 0;
+    virtual void erase(const Key& key) = 0;
+    virtual bool needsRebuild() const = 0;
+    virtual void reset(size_t keys) = 0;
+    virtual size_t bytes() const = 0;
+};
+
+/**
+* Blocked Bloom filter. Each key picks one cache-line block and sets k
+* bits inside it, so a lookup costs a single cache miss however many
+* bits it tests. The filter cannot unset bits: erase() only counts the
+* key as stale, and the owner rebuilds once needsRebuild() says the
+* filter has filled up or gone stale.
+*/
+template <typename Key, typename Hash = std::hash<Key> >
+class BlockedBloomFilter : public KeyFilterBase<Key>
+{
+public:
+    explicit BlockedBloomFilter(double falsePositiveRate, const Hash& hash = Hash());
+
+    virtual bool mayContain(const Key& key) const;
+    virtual void insert(const Key& key);
+    virtual void erase(const Key& key);
+    virtual bool needsRebuild() const;
+    virtual void reset(size_t keys);
+    virtual size_t bytes() const;
+
+    int probes() const;
+    double bitsPerKey() const;
+
+protected:
+    uint64_t mix(const Key& key) const;
+    uint64_t* block(uint64_t h) const;
+
+    Hash hash_;
+    double bitsPerKey_;
+    int probes_;
+    std::vector<uint64_t> storage_;
+    uint64_t* blocks_;      // storage_ rounded up to a cache line
+    size_t blockCount_;
+    size_t capacity_;
+    size_t keys_;
+    size_t stale_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the BlockedBloomFilter class.
+  -------------------------------------------------
+*/
+
+/**
+* Sizes the bits per key and the number of probes for the requested
+* false positive rate at full capacity: log2(1/p) probes and
+* ln(1/p) / ln(2)^2 bits per key, plus BLOOM_BLOCK_OVERHEAD.
+*/
+template<class Key, class Hash>
+BlockedBloomFilter<Key, Hash>::BlockedBloomFilter(double falsePositiveRate, const Hash& hash) :
+    hash_(hash), blocks_(NULL), blockCount_(0), capacity_(0), keys_(0), stale_(0)
+{
+    double p = std::min(0.5, std::max(1e-6, falsePositiveRate));
+    double bits = -std::log(p) / (std::log(2.0) * std::log(2.0));
+    bitsPerKey_ = bits * (1 + BLOOM_BLOCK_OVERHEAD * -std::log10(p));
+    probes_ = std::max(1, std::min(16, (int)std::lround(std::log(2.0) * bits)));
+    reset(0);
+}
+
+template<class Key, class Hash>
+bool BlockedBloomFilter<Key, Hash>::mayContain(const Key& key) const
+{
+    uint64_t h = mix(key);
+    const uint64_t* b = block(h);
+    uint32_t bit = (uint32_t)h;
+    uint32_t step = (uint32_t)(h >> 9) | 1;
+    for (int i = 0; i < probes_; ++i, bit += step) {
+        uint32_t pos = bit % BLOOM_BLOCK_BITS;
+        if ((b[pos / 64] & ((uint64_t)1 << (pos % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<class Key, class Hash>
+void BlockedBloomFilter<Key, Hash>::insert(const Key& key)
+{
+    uint64_t h = mix(key);
+    uint64_t* b = block(h);
+    uint32_t bit = (uint32_t)h;
+    uint32_t step = (uint32_t)(h >> 9) | 1;
+    for (int i = 0; i < probes_; ++i, bit += step) {
+        uint32_t pos = bit % BLOOM_BLOCK_BITS;
+        b[pos / 64] |= (uint64_t)1 << (pos % 64);
+    }
+    ++keys_;
+}
+
+template<class Key, class Hash>
+void BlockedBloomFilter<Key, Hash>::erase(const Key& key)
+{
+    ++stale_;
+}
+
+template<class Key, class Hash>
+bool BlockedBloomFilter<Key, Hash>::needsRebuild() const
+{
+    return keys_ >= capacity_ || (keys_ >= BLOOM_MIN_KEYS && stale_ >= keys_ * BLOOM_MAX_STALE);
+}
+
+/**
+* Empties the filter and sizes it for twice keys, the number of keys
+* about to be inserted again.
+*/
+template<class Key, class Hash>
+void BlockedBloomFilter<Key, Hash>::reset(size_t keys)
+{
+    capacity_ = std::max((size_t)BLOOM_MIN_KEYS, 2 * keys);
+    blockCount_ = (size_t)std::ceil(capacity_ * bitsPerKey_ / BLOOM_BLOCK_BITS);
+    std::vector<uint64_t>().swap(storage_);
+    storage_.assign(blockCount_ * BLOOM_BLOCK_WORDS + BLOOM_BLOCK_WORDS - 1, 0);
+    uintptr_t start = (uintptr_t)&storage_[0];
+    blocks_ = &storage_[0] + ((64 - start % 64) % 64) / sizeof(uint64_t);
+    keys_ = 0;
+    stale_ = 0;
+}
+
+template<class Key, class Hash>
+size_t BlockedBloomFilter<Key, Hash>::bytes() const
+{
+    return sizeof(*this) + storage_.capacity() * sizeof(uint64_t);
+}
+
+template<class Key, class Hash>
+int BlockedBloomFilter<Key, Hash>::probes() const
+{
+    return probes_;
+}
+
+template<class Key, class Hash>
+double BlockedBloomFilter<Key, Hash>::bitsPerKey() const
+{
+    return bitsPerKey_;
+}
+
+/**
+* std::hash of an integer is the integer itself, so the hash is run
+* through the murmur3 finalizer before its bits are split up.
+*/
+template<class Key, class Hash>
+uint64_t BlockedBloomFilter<Key, Hash>::mix(const Key& key) const
+{
+    uint64_t h = (uint64_t)hash_(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+* The high 32 bits pick the block (multiply-shift instead of a modulo);
+* the low bits are left for the bit positions.
+*/
+template<class Key, class Hash>
+uint64_t* BlockedBloomFilter<Key, Hash>::block(uint64_t h) const
+{
+    return blocks_ + (((h >> 32) * blockCount_) >> 32) * BLOOM_BLOCK_WORDS;
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the BlockedBloomFilter class.
+  -------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,1367 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "bst.h"
+#include "avlbst.h"
+#include "mapped_bst.h"
+#include "compact_avlbst.h"
+#include "stack_avlbst.h"
+#include "rbbst.h"
+#include "splaybst.h"
+#include "buffered_avlbst.h"
+#include "augmented_avlbst.h"
+#include "interval_avlbst.h"
+#include "small_avlbst.h"
+
+using namespace std;
+
+// Benchmarks for the search trees.
+//
+//   ./bst-bench restart [entries]   rebuild from text vs. save()/load()
+//   ./bst-bench mapped [entries]    load() vs. mapping a tree image
+//   ./bst-bench compact [entries]   bytes per entry and finds, AVLTree vs. CompactAVLTree
+//   ./bst-bench parentless [entries] insert/scan/remove, AVLTree vs. StackAVLTree
+//   ./bst-bench redblack [entries]  write-heavy workloads, AVLTree vs. RedBlackTree
+//   ./bst-bench splay [entries]     Zipf-distributed finds, AVLTree vs. SplayTree modes
+//   ./bst-bench stats [entries]     AVLTree operation counters (build with -DBST_STATS)
+//   ./bst-bench latency [entries]   p50/p99/p999/max per operation for each tree engine
+//   ./bst-bench memory [entries]    bytes per entry by key/value type and tree engine
+//   ./bst-bench shape [entries]     height, search path lengths and balance factors per engine
+//   ./bst-bench upsert [entries]    Zipf key counting: find + insert vs. upsert() vs. getOrInsert()
+//   ./bst-bench erase [entries]     range and scan deletes: remove() per key vs. erase()
+//   ./bst-bench tombstone [entries] TTL-style delete burst, eager vs. lazy AVLTree deletes
+//   ./bst-bench buffered [entries]  ingest and read cost, AVLTree vs. BufferedAVLTree settings
+//   ./bst-bench batch [entries]     sorted batches: insert() per key vs. insert_batch()
+//   ./bst-bench aggregate [entries] range sums: iteration vs. AugmentedAVLTree::aggregate()
+//   ./bst-bench interval [entries]  overlap queries: scanning the intervals vs. IntervalTree
+//   ./bst-bench finger [entries]    cursor-like lookups: find() vs. find_from() the previous hit
+//   ./bst-bench hashindex [entries] point gets, updates and memory with and without the hash index
+//   ./bst-bench bloom [entries]     miss-heavy finds with and without the Bloom filter
+//   ./bst-bench small [entries]     many maps of 0-64 entries, AVLTree vs. SmallAVLTree
+
+typedef chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Restart benchmark: the old path parses a text dump and inserts every
+// key, the new one reloads a binary snapshot.
+static void benchRestart(uint64_t entries)
+{
+    const char* textPath = "bench-restart.txt";
+    const char* snapPath = "bench-restart.bsts";
+
+    mt19937_64 rng(104);
+    {
+        ofstream text(textPath);
+        for(uint64_t i = 0; i < entries; ++i) {
+            text << rng() << ' ' << i << '\n';
+        }
+    }
+
+    Clock::time_point start = Clock::now();
+    AVLTree<uint64_t, uint64_t> fromText;
+    {
+        ifstream text(textPath);
+        uint64_t key, value;
+        while(text >> key >> value) {
+            fromText.insert(std::make_pair(key, value));
+        }
+    }
+    double insertTime = secondsSince(start);
+
+    start = Clock::now();
+    fromText.save(snapPath);
+    double saveTime = secondsSince(start);
+
+    start = Clock::now();
+    AVLTree<uint64_t, uint64_t> fromSnapshot;
+    fromSnapshot.load(snapPath);
+    double loadTime = secondsSince(start);
+
+    cout << "entries:            " << entries << endl;
+    cout << "text + insert (s):  " << insertTime << endl;
+    cout << "save (s):           " << saveTime << endl;
+    cout << "load (s):           " << loadTime << endl;
+
+    remove(textPath);
+    remove(snapPath);
+}
+
+// Startup benchmark for read-mostly data: a snapshot still allocates
+// every node on load(), while a tree image is usable once it is mapped.
+static void benchMapped(uint64_t entries)
+{
+    const char* snapPath = "bench-mapped.bsts";
+    const char* imagePath = "bench-mapped.bsti";
+
+    vector<uint64_t> probes;
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        mt19937_64 rng(104);
+        BSTSnapshotWriter<uint64_t, uint64_t> out(snapPath);
+        for(uint64_t i = 0; i < entries; ++i) {
+            out.put(std::make_pair(2 * i, i));
+        }
+        out.finish();
+        tree.load(snapPath);
+        MappedTreeWriter<uint64_t, uint64_t>::write(tree, imagePath);
+        for(int i = 0; i < 1000000; ++i) {
+            probes.push_back(rng() % (2 * entries));
+        }
+    }
+
+    Clock::time_point start = Clock::now();
+    AVLTree<uint64_t, uint64_t> loaded;
+    loaded.load(snapPath);
+    double loadTime = secondsSince(start);
+
+    start = Clock::now();
+    MappedTree<uint64_t, uint64_t> mapped(imagePath);
+    double mapTime = secondsSince(start);
+
+    uint64_t hits = 0;
+    start = Clock::now();
+    for(size_t i = 0; i < probes.size(); ++i) {
+        hits += (loaded.find(probes[i]) != loaded.end());
+    }
+    double treeFind = secondsSince(start);
+
+    start = Clock::now();
+    for(size_t i = 0; i < probes.size(); ++i) {
+        hits += (mapped.find(probes[i]) != mapped.end());
+    }
+    double mappedFind = secondsSince(start);
+
+    cout << "entries:               " << entries << endl;
+    cout << "load (s):              " << loadTime << endl;
+    cout << "map (s):               " << mapTime << endl;
+    cout << "1M finds, AVLTree (s): " << treeFind << endl;
+    cout << "1M finds, mapped (s):  " << mappedFind << endl;
+    cout << "(hits: " << hits << ")" << endl;
+
+    remove(snapPath);
+    remove(imagePath);
+}
+
+// Resident set size of this process in bytes (Linux only).
+static uint64_t residentBytes()
+{
+    uint64_t pages = 0, resident = 0;
+    ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * 4096;
+}
+
+// Fills tree with the given keys and reports bytes per entry and the
+// time for 1M random finds.
+template<typename Tree>
+static void measureLayout(const char* name, Tree& tree, const vector<uint64_t>& keys, const vector<uint64_t>& probes)
+{
+    uint64_t before = residentBytes();
+    for(size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], (uint64_t)i));
+    }
+    double bytes = (double)(residentBytes() - before);
+
+    uint64_t hits = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < probes.size(); ++i) {
+        hits += (tree.find(probes[i]) != tree.end());
+    }
+    double findTime = secondsSince(start);
+
+    cout << name << ": " << bytes / keys.size() << " bytes/entry, 1M finds "
+         << findTime << " s (hits " << hits << ")" << endl;
+}
+
+// Layout benchmark: pointer-linked AVLNodes vs. index-linked CompactAVLTree nodes.
+static void benchCompact(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+    vector<uint64_t> probes;
+    for(int i = 0; i < 1000000; ++i) {
+        probes.push_back((i % 2) ? keys[rng() % entries] : rng());
+    }
+
+    cout << "entries: " << entries << endl;
+    cout << "sizeof(AVLNode<uint64_t, uint64_t>): " << sizeof(AVLNode<uint64_t, uint64_t>) << endl;
+    {
+        CompactAVLTree<uint64_t, uint64_t> compact;
+        compact.reserve(entries);
+        measureLayout("CompactAVLTree", compact, keys, probes);
+        cout << "CompactAVLTree memoryBytes(): " << (double)compact.memoryBytes() / entries << " bytes/entry" << endl;
+    }
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        measureLayout("AVLTree", tree, keys, probes);
+    }
+}
+
+// Inserts the keys, scans the tree in order and removes the keys in a
+// different random order, timing each phase.
+template<typename Tree>
+static void measureUpdates(const char* name, const vector<uint64_t>& keys, const vector<uint64_t>& removeOrder)
+{
+    Tree tree;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], (uint64_t)i));
+    }
+    double insertTime = secondsSince(start);
+
+    uint64_t sum = 0;
+    start = Clock::now();
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        sum += it->second;
+    }
+    double scanTime = secondsSince(start);
+
+    start = Clock::now();
+    for(size_t i = 0; i < removeOrder.size(); ++i) {
+        tree.remove(removeOrder[i]);
+    }
+    double removeTime = secondsSince(start);
+
+    cout << name << ": insert " << insertTime << " s, scan " << scanTime
+         << " s, remove " << removeTime << " s (sum " << sum << ")" << endl;
+}
+
+// Parent-linked AVLNodes vs. StackAVLTree nodes that have no parent pointer.
+static void benchParentless(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+    vector<uint64_t> removeOrder(keys);
+    shuffle(removeOrder.begin(), removeOrder.end(), rng);
+
+    cout << "entries: " << entries << endl;
+    cout << "sizeof(AVLNode<uint64_t, uint64_t>):      " << sizeof(AVLNode<uint64_t, uint64_t>) << endl;
+    cout << "sizeof(StackAVLNode<uint64_t, uint64_t>): " << sizeof(StackAVLNode<uint64_t, uint64_t>) << endl;
+    measureUpdates<AVLTree<uint64_t, uint64_t> >("AVLTree", keys, removeOrder);
+    measureUpdates<StackAVLTree<uint64_t, uint64_t> >("StackAVLTree", keys, removeOrder);
+}
+
+// Runs the insert-heavy, delete-heavy and mixed workloads on one tree type.
+template<typename Tree>
+static void measureWrites(const char* name, const vector<uint64_t>& keys, const vector<uint64_t>& removeOrder)
+{
+    double insertTime, removeTime, mixedTime;
+    {
+        Tree tree;
+        Clock::time_point start = Clock::now();
+        for(size_t i = 0; i < keys.size(); ++i) {
+            tree.insert(std::make_pair(keys[i], (uint64_t)i));
+        }
+        insertTime = secondsSince(start);
+
+        start = Clock::now();
+        for(size_t i = 0; i < removeOrder.size(); ++i) {
+            tree.remove(removeOrder[i]);
+        }
+        removeTime = secondsSince(start);
+    }
+    {
+        // half inserts, half removes over a key range twice the tree size
+        Tree tree;
+        mt19937_64 rng(31);
+        uint64_t range = 2 * keys.size();
+        Clock::time_point start = Clock::now();
+        for(size_t i = 0; i < 2 * keys.size(); ++i) {
+            uint64_t r = rng();
+            if(r & 1) {
+                tree.insert(std::make_pair((r >> 1) % range, (uint64_t)i));
+            }
+            else {
+                tree.remove((r >> 1) % range);
+            }
+        }
+        mixedTime = secondsSince(start);
+    }
+    cout << name << ": insert " << insertTime << " s, remove " << removeTime
+         << " s, mixed " << mixedTime << " s" << endl;
+}
+
+// Write-heavy workloads: AVL rebalancing vs. red-black recoloring.
+static void benchRedBlack(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+    vector<uint64_t> removeOrder(keys);
+    shuffle(removeOrder.begin(), removeOrder.end(), rng);
+
+    cout << "entries: " << entries << endl;
+    measureWrites<AVLTree<uint64_t, uint64_t> >("AVLTree", keys, removeOrder);
+    measureWrites<RedBlackTree<uint64_t, uint64_t> >("RedBlackTree", keys, removeOrder);
+}
+
+// Draws count key ranks from a Zipf(exponent) distribution over [0, entries).
+static vector<uint64_t> zipfRanks(uint64_t entries, double exponent, size_t count, mt19937_64& rng)
+{
+    vector<double> cdf(entries);
+    double total = 0;
+    for(uint64_t i = 0; i < entries; ++i) {
+        total += 1.0 / pow((double)(i + 1), exponent);
+        cdf[i] = total;
+    }
+    uniform_real_distribution<double> uniform(0, total);
+    vector<uint64_t> ranks(count);
+    for(size_t i = 0; i < count; ++i) {
+        ranks[i] = lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+    }
+    return ranks;
+}
+
+template<typename Tree>
+static double timeFinds(Tree& tree, const vector<uint64_t>& probes)
+{
+    uint64_t hits = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < probes.size(); ++i) {
+        hits += (tree.find(probes[i]) != tree.end());
+    }
+    double elapsed = secondsSince(start);
+    if(hits != probes.size()) {
+        cerr << "missed " << probes.size() - hits << " keys" << endl;
+    }
+    return elapsed;
+}
+
+template<typename Tree>
+static void fillTree(Tree& tree, const vector<uint64_t>& keys)
+{
+    for(size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], (uint64_t)i));
+    }
+}
+
+// Skewed lookups: hot keys are scattered across the key space and looked
+// up according to Zipf distributions of increasing skew.
+static void benchSplay(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+
+    cout << "entries: " << entries << ", 2M finds per run" << endl;
+    const double exponents[] = { 0.8, 1.0, 1.2 };
+    for(size_t e = 0; e < sizeof(exponents) / sizeof(exponents[0]); ++e) {
+        vector<uint64_t> probes = zipfRanks(entries, exponents[e], 2000000, rng);
+        for(size_t i = 0; i < probes.size(); ++i) {
+            probes[i] = keys[probes[i]];
+        }
+
+        AVLTree<uint64_t, uint64_t> avl;
+        SplayTree<uint64_t, uint64_t> splay;
+        SplayTree<uint64_t, uint64_t> semi(1, true);
+        SplayTree<uint64_t, uint64_t> every4(4);
+        fillTree(avl, keys);
+        fillTree(splay, keys);
+        fillTree(semi, keys);
+        fillTree(every4, keys);
+
+        cout << "zipf " << exponents[e] << ":"
+             << " AVLTree " << timeFinds(avl, probes) << " s,"
+             << " splay " << timeFinds(splay, probes) << " s,"
+             << " semi-splay " << timeFinds(semi, probes) << " s,"
+             << " splay every 4th " << timeFinds(every4, probes) << " s" << endl;
+    }
+}
+
+static void printStats(const char* phase, const BSTStats& stats)
+{
+    cout << phase << ": comparisons " << stats.comparisons
+         << ", finds " << stats.finds
+         << ", visits/find " << (stats.finds ? (double)stats.findVisits / stats.finds : 0)
+         << ", rotations " << stats.singleRotations << " single / " << stats.doubleRotations << " double"
+         << ", node swaps " << stats.nodeSwaps
+         << ", allocations " << stats.allocations
+         << ", frees " << stats.frees << endl;
+}
+
+// Operation counts for an insert, find and remove workload on AVLTree.
+static void benchStats(uint64_t entries)
+{
+#ifndef BST_STATS
+    cerr << "counters are compiled out; rebuild with -DBST_STATS (see Makefile)" << endl;
+#endif
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+
+    AVLTree<uint64_t, uint64_t> tree;
+    cout << "entries: " << entries << endl;
+    fillTree(tree, keys);
+    printStats("insert", tree.stats());
+
+    tree.resetStats();
+    for(uint64_t i = 0; i < entries; ++i) {
+        tree.find((i % 2) ? keys[rng() % entries] : rng());
+    }
+    printStats("find", tree.stats());
+
+    tree.resetStats();
+    for(uint64_t i = 0; i < entries; i += 2) {
+        tree.remove(keys[i]);
+    }
+    printStats("remove half", tree.stats());
+}
+
+static void printLatency(const char* name, const char* op, const LatencyHistogram& h)
+{
+    cout << name << " " << op << ": p50 " << h.p50() << " ns, p99 " << h.p99()
+         << " ns, p999 " << h.p999() << " ns, max " << h.max() << " ns" << endl;
+}
+
+// Tail latency of random inserts, finds (half misses) and removes.
+template<typename Tree>
+static void measureLatency(const char* name, Tree& tree, const vector<uint64_t>& keys, const vector<uint64_t>& removeOrder)
+{
+    tree.enableLatency(true);
+    fillTree(tree, keys);
+    for(uint64_t i = 0; i < keys.size(); ++i) {
+        tree.find((i % 2) ? keys[i] : keys[i] + 1);
+    }
+    for(uint64_t i = 0; i < removeOrder.size(); ++i) {
+        tree.remove(removeOrder[i]);
+    }
+    const BSTLatency* latency = tree.latency();
+    printLatency(name, "insert", latency->insert);
+    printLatency(name, "find", latency->find);
+    printLatency(name, "remove", latency->remove);
+}
+
+static void benchLatency(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng() & ~1ULL;
+    }
+    vector<uint64_t> removeOrder(keys);
+    shuffle(removeOrder.begin(), removeOrder.end(), rng);
+
+    cout << "entries: " << entries << endl;
+    {
+        BinarySearchTree<uint64_t, uint64_t> tree;
+        measureLatency("BinarySearchTree", tree, keys, removeOrder);
+    }
+    {
+        BinarySearchTree<uint64_t, uint64_t> tree;
+        tree.setScapegoat(true);
+        measureLatency("scapegoat", tree, keys, removeOrder);
+    }
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        measureLatency("AVLTree", tree, keys, removeOrder);
+    }
+    {
+        RedBlackTree<uint64_t, uint64_t> tree;
+        measureLatency("RedBlackTree", tree, keys, removeOrder);
+    }
+    {
+        SplayTree<uint64_t, uint64_t> tree;
+        measureLatency("SplayTree", tree, keys, removeOrder);
+    }
+}
+
+static void makeItem(uint64_t x, uint64_t& out) { out = x; }
+static void makeItem(uint64_t x, int& out) { out = (int)x; }
+static void makeItem(uint64_t x, string& out)
+{
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)x);
+    out = buf;
+}
+
+// Fills a tree with random items and prints its memoryUsage() breakdown.
+template<typename Tree, typename Key, typename Value>
+static void measureMemory(const char* name, const char* types, uint64_t entries)
+{
+    mt19937_64 rng(104);
+    Tree tree;
+    for(uint64_t i = 0; i < entries; ++i) {
+        Key key;
+        Value value;
+        makeItem(rng(), key);
+        makeItem(i, value);
+        tree.insert(std::make_pair(key, value));
+    }
+    BSTMemoryUsage usage = tree.memoryUsage();
+    double n = usage.nodes ? (double)usage.nodes : 1;
+    cout << name << " " << types << ": " << usage.bytesPerEntry() << " bytes/entry ("
+         << usage.payloadBytes / n << " payload, "
+         << usage.vtableBytes / n << " vtable, "
+         << usage.pointerBytes / n << " pointers, "
+         << usage.balanceBytes / n << " balance, "
+         << usage.paddingBytes / n << " padding, "
+         << usage.slackBytes / n << " allocator slack)" << endl;
+}
+
+template<typename Key, typename Value>
+static void measureMemoryEngines(const char* types, uint64_t entries)
+{
+    measureMemory<BinarySearchTree<Key, Value>, Key, Value>("BinarySearchTree", types, entries);
+    measureMemory<AVLTree<Key, Value>, Key, Value>("AVLTree", types, entries);
+    measureMemory<RedBlackTree<Key, Value>, Key, Value>("RedBlackTree", types, entries);
+}
+
+static void benchMemory(uint64_t entries)
+{
+    cout << "entries: " << entries << endl;
+    measureMemoryEngines<int, int>("<int, int>", entries);
+    measureMemoryEngines<uint64_t, uint64_t>("<uint64_t, uint64_t>", entries);
+    measureMemoryEngines<string, uint64_t>("<string, uint64_t>", entries);
+    measureMemoryEngines<uint64_t, string>("<uint64_t, string>", entries);
+}
+
+// Sorted insertion turns a plain BinarySearchTree into a list, which
+// takes quadratic time to build; the shape run caps it at this size.
+#define BENCH_SHAPE_SORTED_LIMIT 20000
+
+template<typename Tree>
+static void printShape(const char* name, const Tree& tree)
+{
+    Clock::time_point start = Clock::now();
+    BSTShape shape = tree.shape();
+    double elapsed = secondsSince(start);
+
+    cout << name << ": " << shape.nodes << " nodes, height " << shape.height
+         << ", mean path " << shape.meanHitPath << " hit / " << shape.meanMissPath << " miss, balance";
+    if(shape.balanceComplete) {
+        for(int b = -BST_SHAPE_BALANCE_RANGE; b <= BST_SHAPE_BALANCE_RANGE; ++b) {
+            cout << " " << shape.nodesWithBalance(b);
+        }
+    }
+    else {
+        cout << " n/a";
+    }
+    cout << " (profiled in " << elapsed << " s)" << endl;
+}
+
+static void benchShape(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+    vector<uint64_t> sorted(keys);
+    sort(sorted.begin(), sorted.end());
+    vector<uint64_t> sortedPrefix(sorted.begin(), sorted.begin() + min(entries, (uint64_t)BENCH_SHAPE_SORTED_LIMIT));
+
+    cout << "entries: " << entries << ", balance factors " << -BST_SHAPE_BALANCE_RANGE
+         << " (or less) to " << BST_SHAPE_BALANCE_RANGE << " (or more)" << endl;
+    {
+        BinarySearchTree<uint64_t, uint64_t> tree;
+        fillTree(tree, keys);
+        printShape("BinarySearchTree random", tree);
+    }
+    {
+        BinarySearchTree<uint64_t, uint64_t> tree;
+        fillTree(tree, sortedPrefix);
+        printShape("BinarySearchTree sorted", tree);
+    }
+    {
+        BinarySearchTree<uint64_t, uint64_t> tree;
+        tree.setScapegoat(true);
+        fillTree(tree, sorted);
+        printShape("scapegoat sorted", tree);
+    }
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        fillTree(tree, keys);
+        printShape("AVLTree random", tree);
+    }
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        fillTree(tree, sorted);
+        printShape("AVLTree sorted", tree);
+    }
+    {
+        RedBlackTree<uint64_t, uint64_t> tree;
+        fillTree(tree, keys);
+        printShape("RedBlackTree random", tree);
+    }
+    {
+        RedBlackTree<uint64_t, uint64_t> tree;
+        fillTree(tree, sorted);
+        printShape("RedBlackTree sorted", tree);
+    }
+}
+
+// Counts how often each key occurs in probes, the way callers did it
+// before upsert(): a find() and then an insert() of the new count.
+template<typename Tree>
+static double countWithFind(Tree& tree, const vector<uint64_t>& probes)
+{
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < probes.size(); ++i) {
+        typename Tree::iterator it = tree.find(probes[i]);
+        tree.insert(std::make_pair(probes[i], (it != tree.end()) ? it->second + 1 : 1));
+    }
+    return secondsSince(start);
+}
+
+template<typename Tree>
+static double countWithUpsert(Tree& tree, const vector<uint64_t>& probes)
+{
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < probes.size(); ++i) {
+        tree.upsert(probes[i], 1, std::plus<uint64_t>());
+    }
+    return secondsSince(start);
+}
+
+template<typename Tree>
+static double countWithGetOrInsert(Tree& tree, const vector<uint64_t>& probes)
+{
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < probes.size(); ++i) {
+        ++tree.getOrInsert(probes[i]);
+    }
+    return secondsSince(start);
+}
+
+template<typename Tree>
+static void measureCounting(const char* name, const vector<uint64_t>& probes)
+{
+    Tree viaFind, viaUpsert, viaGet;
+    double findTime = countWithFind(viaFind, probes);
+    double upsertTime = countWithUpsert(viaUpsert, probes);
+    double getTime = countWithGetOrInsert(viaGet, probes);
+    cout << name << ": find + insert " << findTime << " s, upsert " << upsertTime
+         << " s, getOrInsert " << getTime << " s" << endl;
+}
+
+static void benchUpsert(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> probes = zipfRanks(entries, 1.0, 4 * entries, rng);
+    // scatter the ranks so popular keys are not also the smallest ones
+    for(size_t i = 0; i < probes.size(); ++i) {
+        probes[i] *= 0x9E3779B97F4A7C15ULL;
+    }
+
+    cout << "distinct keys: up to " << entries << ", counted items: " << probes.size() << endl;
+    measureCounting<AVLTree<uint64_t, uint64_t> >("AVLTree", probes);
+    measureCounting<RedBlackTree<uint64_t, uint64_t> >("RedBlackTree", probes);
+    measureCounting<BinarySearchTree<uint64_t, uint64_t> >("BinarySearchTree", probes);
+}
+
+// Removes the keys in [lo, hi) one remove() at a time.
+template<typename Tree>
+static double rangeByKey(Tree& tree, uint64_t lo, uint64_t hi)
+{
+    vector<uint64_t> doomed;
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        if(it->first >= lo && it->first < hi) {
+            doomed.push_back(it->first);
+        }
+    }
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < doomed.size(); ++i) {
+        tree.remove(doomed[i]);
+    }
+    return secondsSince(start);
+}
+
+template<typename Tree>
+static double rangeByErase(Tree& tree, uint64_t lo, uint64_t hi)
+{
+    typename Tree::iterator first = tree.begin();
+    while(first != tree.end() && first->first < lo) {
+        ++first;
+    }
+    typename Tree::iterator last = first;
+    while(last != tree.end() && last->first < hi) {
+        ++last;
+    }
+    Clock::time_point start = Clock::now();
+    tree.erase(first, last);
+    return secondsSince(start);
+}
+
+static void benchErase(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+    cout << "entries: " << entries << endl;
+
+    const double fractions[] = { 0.001, 0.01, 0.1, 0.5, 0.9 };
+    for(int f = 0; f < 5; ++f) {
+        uint64_t lo = (uint64_t)((1.0 - fractions[f]) / 2 * (double)UINT64_MAX);
+        uint64_t hi = lo + (uint64_t)(fractions[f] * (double)UINT64_MAX);
+        AVLTree<uint64_t, uint64_t> byKey, byErase;
+        fillTree(byKey, keys);
+        fillTree(byErase, keys);
+        cout << "range of " << fractions[f] * 100 << "% of the keys: remove() per key "
+             << rangeByKey(byKey, lo, hi) << " s, erase(first, last) " << rangeByErase(byErase, lo, hi) << " s" << endl;
+    }
+
+    // delete every other item during a scan
+    AVLTree<uint64_t, uint64_t> byKey, byIterator;
+    fillTree(byKey, keys);
+    fillTree(byIterator, keys);
+    Clock::time_point start = Clock::now();
+    bool drop = false;
+    for(AVLTree<uint64_t, uint64_t>::iterator it = byKey.begin(); it != byKey.end(); ) {
+        uint64_t key = it->first;
+        ++it;
+        if((drop = !drop)) {
+            byKey.remove(key);
+        }
+    }
+    double keyTime = secondsSince(start);
+    start = Clock::now();
+    drop = false;
+    for(AVLTree<uint64_t, uint64_t>::iterator it = byIterator.begin(); it != byIterator.end(); ) {
+        if((drop = !drop)) {
+            it = byIterator.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    cout << "scan deleting every other item: remove() " << keyTime << " s, erase(iterator) "
+         << secondsSince(start) << " s" << endl;
+
+    AVLTree<uint64_t, uint64_t> byPredicate;
+    fillTree(byPredicate, keys);
+    start = Clock::now();
+    uint64_t removed = byPredicate.erase_if([](const pair<const uint64_t, uint64_t>& item) { return item.first % 2 == 0; });
+    cout << "erase_if of the even keys: " << removed << " removed in " << secondsSince(start) << " s" << endl;
+}
+
+// Expires the oldest half of the keys (in insertion order) while a find
+// runs between removes, then refills, and reports remove latency.
+static void measureExpiry(const char* name, AVLTree<uint64_t, uint64_t>& tree, const vector<uint64_t>& keys)
+{
+    tree.enableLatency(true);
+    fillTree(tree, keys);
+    tree.resetLatency();
+    uint64_t half = keys.size() / 2;
+    uint64_t hits = 0;
+    Clock::time_point start = Clock::now();
+    for(uint64_t i = 0; i < half; ++i) {
+        tree.remove(keys[i]);
+        hits += (tree.find(keys[keys.size() - 1 - i]) != tree.end());
+    }
+    double expire = secondsSince(start);
+    start = Clock::now();
+    for(uint64_t i = 0; i < half; ++i) {
+        tree.insert(std::make_pair(keys[i], i));
+    }
+    double refill = secondsSince(start);
+    printLatency(name, "remove", tree.latency()->remove);
+    cout << name << ": expiry " << expire << " s (" << hits << " finds hit), refill " << refill << " s" << endl;
+}
+
+static void benchTombstone(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+    cout << "entries: " << entries << endl;
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        measureExpiry("eager", tree, keys);
+    }
+    const double thresholds[] = { 0.1, 0.25, 0.5 };
+    for(int t = 0; t < 3; ++t) {
+        AVLTree<uint64_t, uint64_t> tree;
+        tree.setLazyDelete(true);
+        tree.setCompactionThreshold(thresholds[t]);
+        char name[32];
+        snprintf(name, sizeof(name), "lazy %.2f", thresholds[t]);
+        measureExpiry(name, tree, keys);
+        AVLCompactionStats stats = tree.compactionStats();
+        cout << name << ": " << stats.lazyDeletes << " marked, " << stats.purged << " purged, "
+             << stats.revived << " revived, " << stats.tombstones << " left, "
+             << stats.compactions << " compaction passes" << endl;
+    }
+}
+
+static bool lookupValue(AVLTree<uint64_t, uint64_t>& tree, uint64_t key, uint64_t& value)
+{
+    AVLTree<uint64_t, uint64_t>::iterator it = tree.find(key);
+    if(it == tree.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+static bool lookupValue(BufferedAVLTree<uint64_t, uint64_t>& tree, uint64_t key, uint64_t& value)
+{
+    return tree.get(key, value);
+}
+
+// Ingests keys, then times finds of all of them; whatever is still
+// buffered is read from the buffer.
+template<typename Tree>
+static void measureIngest(const char* name, Tree& tree, const vector<uint64_t>& keys, const vector<uint64_t>& probes)
+{
+    Clock::time_point start = Clock::now();
+    for(uint64_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], i));
+    }
+    double ingest = secondsSince(start);
+    uint64_t hits = 0;
+    uint64_t value;
+    start = Clock::now();
+    for(uint64_t i = 0; i < probes.size(); ++i) {
+        hits += lookupValue(tree, probes[i], value);
+    }
+    double reads = secondsSince(start);
+    cout << name << ": ingest " << keys.size() / ingest / 1e6 << " M keys/s, finds "
+         << reads * 1e9 / probes.size() << " ns each (" << hits << " hits)" << endl;
+}
+
+static void compareBuffered(const char* stream, const vector<uint64_t>& writes, const vector<uint64_t>& probes)
+{
+    cout << stream << ":" << endl;
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        measureIngest("AVLTree", tree, writes, probes);
+    }
+    const size_t capacities[] = { 64, 256, 1024, 4096 };
+    const char* policies[] = { "auto", "insert", "rebuild" };
+    for(int p = 0; p < 3; ++p) {
+        for(int c = 0; c < 4; ++c) {
+            if(p == 2 && capacities[c] * 64 < writes.size()) {
+                continue;   // O(n) per flush; far too slow with small buffers
+            }
+            BufferedAVLTree<uint64_t, uint64_t> tree;
+            tree.setBufferCapacity(capacities[c]);
+            tree.setMergePolicy((BufferedAVLTree<uint64_t, uint64_t>::MergePolicy)p);
+            char name[64];
+            snprintf(name, sizeof(name), "buffered %s %zu", policies[p], capacities[c]);
+            measureIngest(name, tree, writes, probes);
+        }
+    }
+}
+
+static void benchBuffered(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+    vector<uint64_t> probes(keys);
+    shuffle(probes.begin(), probes.end(), rng);
+
+    cout << "entries: " << entries << endl;
+    compareBuffered("distinct random keys", keys, probes);
+
+    // hot keys are rewritten many times; the buffer absorbs the repeats
+    vector<uint64_t> ranks = zipfRanks(entries, 1.0, entries, rng);
+    vector<uint64_t> zipf(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        zipf[i] = keys[ranks[i]];
+    }
+    compareBuffered("Zipf(1.0) rewrites of the same keys", zipf, probes);
+}
+
+// Inserts sorted batches of the given size until total keys went in,
+// one insert() per key or one insert_batch() per batch.
+static double insertBatches(AVLTree<uint64_t, uint64_t>& tree, const vector<uint64_t>& keys, size_t batchSize, bool batched)
+{
+    vector<pair<uint64_t, uint64_t> > batch;
+    double elapsed = 0;
+    for(size_t at = 0; at < keys.size(); at += batchSize) {
+        batch.clear();
+        for(size_t i = at; i < keys.size() && i < at + batchSize; ++i) {
+            batch.push_back(std::make_pair(keys[i], (uint64_t)i));
+        }
+        sort(batch.begin(), batch.end());
+        Clock::time_point start = Clock::now();
+        if(batched) {
+            tree.insert_batch(batch.begin(), batch.end());
+        }
+        else {
+            for(size_t i = 0; i < batch.size(); ++i) {
+                tree.insert(batch[i]);
+            }
+        }
+        elapsed += secondsSince(start);
+    }
+    return elapsed;
+}
+
+static void benchBatch(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> base(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        base[i] = rng();
+    }
+    cout << "tree: " << entries << " random keys; " << entries / 10 << " new keys per run" << endl;
+    vector<uint64_t> incoming(entries / 10);
+    for(uint64_t i = 0; i < incoming.size(); ++i) {
+        incoming[i] = rng();
+    }
+    const size_t sizes[] = { 1000, 10000, 100000 };
+    for(int s = 0; s < 3; ++s) {
+        AVLTree<uint64_t, uint64_t> perKey, batched;
+        fillTree(perKey, base);
+        fillTree(batched, base);
+        double keyTime = insertBatches(perKey, incoming, sizes[s], false);
+        double batchTime = insertBatches(batched, incoming, sizes[s], true);
+        cout << "batches of " << sizes[s] << ": insert() " << keyTime << " s, insert_batch() " << batchTime
+             << " s (" << keyTime / batchTime << "x)" << endl;
+    }
+
+    // batch as large as the tree: takes the merge-and-relink path
+    AVLTree<uint64_t, uint64_t> perKey, batched;
+    vector<uint64_t> half(base.begin(), base.begin() + entries / 2);
+    vector<uint64_t> rest(base.begin() + entries / 2, base.end());
+    fillTree(perKey, half);
+    fillTree(batched, half);
+    double keyTime = insertBatches(perKey, rest, rest.size(), false);
+    double batchTime = insertBatches(batched, rest, rest.size(), true);
+    cout << "one batch of " << rest.size() << " into " << half.size() << " keys: insert() " << keyTime
+         << " s, insert_batch() " << batchTime << " s (" << keyTime / batchTime << "x)" << endl;
+
+    AVLTree<uint64_t, uint64_t> emptyPerKey, emptyBatched;
+    keyTime = insertBatches(emptyPerKey, base, base.size(), false);
+    batchTime = insertBatches(emptyBatched, base, base.size(), true);
+    cout << "one batch of " << base.size() << " into an empty tree: insert() " << keyTime
+         << " s, insert_batch() " << batchTime << " s (" << keyTime / batchTime << "x)" << endl;
+}
+
+static void benchAggregate(uint64_t entries)
+{
+    mt19937_64 rng(104);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+
+    // the upkeep: the same build with and without summaries
+    AVLTree<uint64_t, uint64_t> plain;
+    AugmentedAVLTree<uint64_t, uint64_t, SumMonoid<uint64_t> > summed;
+    Clock::time_point start = Clock::now();
+    fillTree(plain, keys);
+    double plainInsert = secondsSince(start);
+    start = Clock::now();
+    fillTree(summed, keys);
+    double summedInsert = secondsSince(start);
+    cout << "entries: " << entries << endl;
+    cout << "insert: AVLTree " << plainInsert << " s, AugmentedAVLTree<SumMonoid> " << summedInsert << " s" << endl;
+
+    // windows [sorted[i], sorted[i + width]) hold exactly width keys; the
+    // iteration starts from find() of the first one
+    vector<uint64_t> sorted(keys);
+    sort(sorted.begin(), sorted.end());
+    const uint64_t widths[] = { 10, 100, 1000, 10000, 100000 };
+    const int queries = 1000;
+    for(int w = 0; w < 5 && widths[w] < entries; ++w) {
+        vector<uint64_t> firsts(queries);
+        for(int q = 0; q < queries; ++q) {
+            firsts[q] = rng() % (entries - widths[w]);
+        }
+        uint64_t iterated = 0;
+        start = Clock::now();
+        for(int q = 0; q < queries; ++q) {
+            uint64_t hi = sorted[firsts[q] + widths[w]];
+            for(AVLTree<uint64_t, uint64_t>::iterator it = plain.find(sorted[firsts[q]]); it != plain.end() && it->first < hi; ++it) {
+                iterated += it->second;
+            }
+        }
+        double iterTime = secondsSince(start);
+        uint64_t aggregated = 0;
+        start = Clock::now();
+        for(int q = 0; q < queries; ++q) {
+            aggregated += summed.aggregate(sorted[firsts[q]], sorted[firsts[q] + widths[w]]);
+        }
+        double aggTime = secondsSince(start);
+        cout << "sum over " << widths[w] << " keys: iteration " << iterTime * 1e9 / queries << " ns, aggregate() "
+             << aggTime * 1e9 / queries << " ns" << (iterated == aggregated ? "" : " (MISMATCH)") << endl;
+    }
+}
+
+static void benchInterval(uint64_t entries)
+{
+    // starts spread over [0, 2^40), lengths up to 64 average gaps, so a
+    // point is covered by about 32 intervals
+    const uint64_t span = 1ULL << 40;
+    const uint64_t gap = span / entries;
+    mt19937_64 rng(105);
+    vector<pair<Interval<uint64_t>, uint64_t> > items(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        uint64_t start = rng() % span;
+        items[i] = make_pair(Interval<uint64_t>(start, start + rng() % (64 * gap)), i);
+    }
+
+    IntervalTree<uint64_t, uint64_t> inserted;
+    Clock::time_point start = Clock::now();
+    for(uint64_t i = 0; i < entries; ++i) {
+        inserted.insert(items[i]);
+    }
+    double insertTime = secondsSince(start);
+    IntervalTree<uint64_t, uint64_t> tree;
+    start = Clock::now();
+    tree.bulkLoad(items.begin(), items.end());
+    double loadTime = secondsSince(start);
+    cout << "entries: " << entries << endl;
+    cout << "build: insert() " << insertTime << " s, bulkLoad() " << loadTime << " s" << endl;
+
+    // the scan walks the intervals in start order and stops at the first
+    // one that starts after the query
+    const uint64_t widths[] = { 0, gap, 16 * gap, 256 * gap };
+    const char* names[] = { "stabbing", "1 gap", "16 gaps", "256 gaps" };
+    const int queries = 200;
+    for(int w = 0; w < 4; ++w) {
+        vector<uint64_t> los(queries);
+        for(int q = 0; q < queries; ++q) {
+            los[q] = rng() % span;
+        }
+        uint64_t scanned = 0;
+        start = Clock::now();
+        for(int q = 0; q < queries; ++q) {
+            uint64_t hi = los[q] + widths[w];
+            for(IntervalTree<uint64_t, uint64_t>::iterator it = tree.begin(); it != tree.end() && it->first.start <= hi; ++it) {
+                if(it->first.overlaps(los[q], hi)) {
+                    scanned += it->second;
+                }
+            }
+        }
+        double scanTime = secondsSince(start);
+        uint64_t found = 0;
+        uint64_t hits = 0;
+        start = Clock::now();
+        for(int q = 0; q < queries; ++q) {
+            tree.forEachOverlapping(los[q], los[q] + widths[w], [&](const pair<const Interval<uint64_t>, uint64_t>& item) {
+                found += item.second;
+                ++hits;
+            });
+        }
+        double treeTime = secondsSince(start);
+        cout << names[w] << " (" << (double)hits / queries << " hits): scan " << scanTime * 1e6 / queries
+             << " us, forEachOverlapping() " << treeTime * 1e6 / queries << " us"
+             << (scanned == found ? "" : " (MISMATCH)") << endl;
+    }
+}
+
+static void benchFinger(uint64_t entries)
+{
+    mt19937_64 rng(106);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+    AVLTree<uint64_t, uint64_t> tree;
+    fillTree(tree, keys);
+    sort(keys.begin(), keys.end());
+    cout << "entries: " << entries << endl;
+
+    // a cursor that moves forward by 1..step ranks per lookup, with one
+    // jump to a random rank every 1000 lookups
+    const uint64_t steps[] = { 1, 16, 256, 4096, 65536 };
+    const uint64_t lookups = 1000000;
+    for(int s = 0; s < 5 && steps[s] < entries; ++s) {
+        vector<uint64_t> trace(lookups);
+        uint64_t rank = 0;
+        for(uint64_t i = 0; i < lookups; ++i) {
+            rank = (i % 1000 == 0) ? rng() % entries : (rank + 1 + rng() % steps[s]) % entries;
+            trace[i] = keys[rank];
+        }
+        uint64_t rootSum = 0;
+        Clock::time_point start = Clock::now();
+        for(uint64_t i = 0; i < lookups; ++i) {
+            rootSum += tree.find(trace[i])->second;
+        }
+        double rootTime = secondsSince(start);
+        uint64_t fingerSum = 0;
+        AVLTree<uint64_t, uint64_t>::iterator cursor = tree.end();
+        start = Clock::now();
+        for(uint64_t i = 0; i < lookups; ++i) {
+            cursor = tree.find_from(cursor, trace[i]);
+            fingerSum += cursor->second;
+        }
+        double fingerTime = secondsSince(start);
+        cout << "steps of 1.." << steps[s] << ": find() " << rootTime * 1e9 / lookups << " ns, find_from() "
+             << fingerTime * 1e9 / lookups << " ns" << (rootSum == fingerSum ? "" : " (MISMATCH)") << endl;
+    }
+}
+
+static void benchHashIndexRun(const char* name, bool indexed, const vector<uint64_t>& keys,
+                              const vector<uint64_t>& gets, const vector<uint64_t>& churn)
+{
+    AVLTree<uint64_t, uint64_t> tree;
+    tree.enableHashIndex(indexed);
+    Clock::time_point start = Clock::now();
+    fillTree(tree, keys);
+    double fill = secondsSince(start);
+
+    // 80% point gets (a quarter of them misses), 20% short ordered scans
+    uint64_t sum = 0;
+    start = Clock::now();
+    for(size_t i = 0; i < gets.size(); ++i) {
+        if(i % 5 == 4) {
+            AVLTree<uint64_t, uint64_t>::iterator it = tree.lower_bound(gets[i]);
+            for(int j = 0; j < 10 && it != tree.end(); ++j, ++it) {
+                sum += it->second;
+            }
+        }
+        else {
+            AVLTree<uint64_t, uint64_t>::iterator it = tree.find(gets[i]);
+            if(it != tree.end()) {
+                sum += it->second;
+            }
+        }
+    }
+    double mixed = secondsSince(start);
+
+    start = Clock::now();
+    for(size_t i = 0; i < churn.size(); ++i) {
+        tree.remove(keys[i]);
+        tree.insert(make_pair(churn[i], churn[i]));
+    }
+    double update = secondsSince(start);
+
+    BSTMemoryUsage usage = tree.memoryUsage();
+    cout << name << ": fill " << fill << " s, get/scan mix " << mixed * 1e9 / gets.size() << " ns/op, remove+insert "
+         << update * 1e9 / churn.size() << " ns/pair, " << usage.bytesPerEntry() << " bytes/entry ("
+         << (double)usage.indexBytes / usage.nodes << " index)" << " [" << sum % 1000 << "]" << endl;
+}
+
+static void benchHashIndex(uint64_t entries)
+{
+    mt19937_64 rng(107);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+    vector<uint64_t> gets(2000000);
+    for(size_t i = 0; i < gets.size(); ++i) {
+        gets[i] = (i % 4 == 3) ? rng() : keys[rng() % entries];
+    }
+    vector<uint64_t> churn(entries / 4);
+    for(size_t i = 0; i < churn.size(); ++i) {
+        churn[i] = rng();
+    }
+    cout << "entries: " << entries << endl;
+    benchHashIndexRun("AVLTree", false, keys, gets, churn);
+    benchHashIndexRun("AVLTree + hash index", true, keys, gets, churn);
+}
+
+static void benchBloom(uint64_t entries)
+{
+    mt19937_64 rng(108);
+    vector<uint64_t> keys(entries);
+    for(uint64_t i = 0; i < entries; ++i) {
+        keys[i] = rng();
+    }
+    const double missShares[] = { 0.5, 0.9, 0.99 };
+    vector<vector<uint64_t> > traces(3, vector<uint64_t>(2000000));
+    for(int w = 0; w < 3; ++w) {
+        for(size_t i = 0; i < traces[w].size(); ++i) {
+            traces[w][i] = (rng() % 1000 < missShares[w] * 1000) ? rng() : keys[rng() % entries];
+        }
+    }
+    cout << "entries: " << entries << endl;
+
+    const double rates[] = { 0, 0.05, 0.01, 0.001 };
+    for(int r = 0; r < 4; ++r) {
+        AVLTree<uint64_t, uint64_t> tree;
+        if(rates[r] > 0) {
+            tree.enableBloomFilter(true, rates[r]);
+        }
+        Clock::time_point start = Clock::now();
+        fillTree(tree, keys);
+        double fill = secondsSince(start);
+        BSTMemoryUsage usage = tree.memoryUsage();
+        if(rates[r] > 0) {
+            cout << "Bloom filter at " << rates[r] * 100 << "%";
+        }
+        else {
+            cout << "no filter";
+        }
+        cout << ": fill " << fill << " s, " << (double)usage.filterBytes / usage.nodes << " filter bytes/entry, finds";
+        for(int w = 0; w < 3; ++w) {
+            uint64_t hits = 0;
+            start = Clock::now();
+            for(size_t i = 0; i < traces[w].size(); ++i) {
+                hits += (tree.find(traces[w][i]) != tree.end());
+            }
+            double t = secondsSince(start);
+            cout << " " << t * 1e9 / traces[w].size() << " ns (" << missShares[w] * 100 << "% misses)";
+        }
+        cout << endl;
+    }
+}
+
+static size_t mapBytes(const AVLTree<uint64_t, uint64_t>& tree)
+{
+    return tree.memoryUsage().totalBytes();
+}
+
+static size_t mapBytes(const SmallAVLTree<uint64_t, uint64_t>& map)
+{
+    return map.memoryBytes();
+}
+
+// Fills one map per key set, then finds every key, and prints the time
+// per operation and the bytes per map.
+template<class Map>
+static void measureSmall(const char* name, const vector<vector<uint64_t> >& keySets)
+{
+    vector<Map> maps(keySets.size());
+    size_t ops = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t m = 0; m < keySets.size(); ++m) {
+        for(size_t i = 0; i < keySets[m].size(); ++i) {
+            maps[m].insert(make_pair(keySets[m][i], keySets[m][i]));
+        }
+        ops += keySets[m].size();
+    }
+    double fill = secondsSince(start);
+    uint64_t sum = 0;
+    start = Clock::now();
+    for(size_t m = 0; m < keySets.size(); ++m) {
+        for(size_t i = 0; i < keySets[m].size(); ++i) {
+            sum += maps[m].find(keySets[m][i]) -> second;
+        }
+    }
+    double finds = secondsSince(start);
+    size_t bytes = 0;
+    for(size_t m = 0; m < maps.size(); ++m) {
+        bytes += mapBytes(maps[m]);
+    }
+    cout << "  " << name << ": " << (double)bytes / maps.size() << " bytes/map";
+    if(ops > 0) {
+        cout << ", insert " << fill * 1e9 / ops << " ns, find " << finds * 1e9 / ops << " ns [" << sum % 1000 << "]";
+    }
+    cout << endl;
+}
+
+static void benchSmall(uint64_t entries)
+{
+    mt19937_64 rng(109);
+    size_t count = max((uint64_t)1, entries / 64);
+    const size_t sizes[] = { 0, 1, 2, 4, 8, 12, 16, 17, 24, 32, 48, 64 };
+    cout << "maps: " << count << ", inline capacity: " << SMALL_AVL_INLINE << endl;
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        vector<vector<uint64_t> > keySets(count, vector<uint64_t>(sizes[s]));
+        for(size_t m = 0; m < count; ++m) {
+            for(size_t i = 0; i < sizes[s]; ++i) {
+                keySets[m][i] = rng();
+            }
+        }
+        cout << sizes[s] << " entries per map" << endl;
+        measureSmall<AVLTree<uint64_t, uint64_t> >("AVLTree", keySets);
+        measureSmall<SmallAVLTree<uint64_t, uint64_t> >("SmallAVLTree", keySets);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2) {
+        cerr << "usage: " << argv[0] << " restart|mapped|compact|parentless|redblack|splay|stats|latency|memory|shape|upsert|erase|tombstone|buffered|batch|aggregate|interval|finger|hashindex|bloom|small [entries]" << endl;
+        return 1;
+    }
+    string mode = argv[1];
+    uint64_t entries = (argc > 2) ? strtoull(argv[2], NULL, 10) : 0;
+
+    if(mode == "restart") {
+        benchRestart(entries ? entries : 1000000);
+    }
+    else if(mode == "mapped") {
+        benchMapped(entries ? entries : 10000000);
+    }
+    else if(mode == "compact") {
+        benchCompact(entries ? entries : 10000000);
+    }
+    else if(mode == "parentless") {
+        benchParentless(entries ? entries : 1000000);
+    }
+    else if(mode == "redblack") {
+        benchRedBlack(entries ? entries : 1000000);
+    }
+    else if(mode == "splay") {
+        benchSplay(entries ? entries : 1000000);
+    }
+    else if(mode == "stats") {
+        benchStats(entries ? entries : 1000000);
+    }
+    else if(mode == "latency") {
+        benchLatency(entries ? entries : 1000000);
+    }
+    else if(mode == "memory") {
+        benchMemory(entries ? entries : 1000000);
+    }
+    else if(mode == "shape") {
+        benchShape(entries ? entries : 1000000);
+    }
+    else if(mode == "upsert") {
+        benchUpsert(entries ? entries : 1000000);
+    }
+    else if(mode == "erase") {
+        benchErase(entries ? entries : 1000000);
+    }
+    else if(mode == "tombstone") {
+        benchTombstone(entries ? entries : 1000000);
+    }
+    else if(mode == "buffered") {
+        benchBuffered(entries ? entries : 1000000);
+    }
+    else if(mode == "batch") {
+        benchBatch(entries ? entries : 1000000);
+    }
+    else if(mode == "aggregate") {
+        benchAggregate(entries ? entries : 1000000);
+    }
+    else if(mode == "interval") {
+        benchInterval(entries ? entries : 1000000);
+    }
+    else if(mode == "finger") {
+        benchFinger(entries ? entries : 1000000);
+    }
+    else if(mode == "hashindex") {
+        benchHashIndex(entries ? entries : 1000000);
+    }
+    else if(mode == "bloom") {
+        benchBloom(entries ? entries : 1000000);
+    }
+    else if(mode == "small") {
+        benchSmall(entries ? entries : 1000000);
+    }
+    else {
+        cerr << "unknown benchmark: " << mode << endl;
+        return 1;
+    }
+    return 0;
+}
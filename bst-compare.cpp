@@ -0,0 +1,354 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "bst.h"
+#include "avlbst.h"
+
+using namespace std;
+
+// Comparative benchmark: BinarySearchTree, AVLTree and std::map run the
+// same workloads and one result row is printed per (tree, key type,
+// workload, size).
+//
+//   ./bst-compare [--json] [--sizes=1000,10000,...]
+//
+// Output is CSV by default:
+//   tree,key_type,workload,keys,ops,seconds,ns_per_op
+//
+// Workloads:
+//   insert_seq, insert_random, insert_zipf   build a tree of `keys` keys
+//   find_hit, find_miss                      lookups in a random-built tree
+//   remove                                   remove every key, random order
+//   mixed_r90, mixed_r50                     90% / 50% finds, rest insert/remove
+//   scan                                     full in-order iteration
+//
+// The plain BinarySearchTree degenerates into a list on sorted input, so
+// insert_seq is skipped for it above BST_COMPARE_SEQ_LIMIT keys.
+
+#define BST_COMPARE_SEQ_LIMIT 20000
+#define BST_COMPARE_ZIPF_EXPONENT 1.0
+
+typedef chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// std::map behind the interface the trees share.
+template<typename Key, typename Value>
+class StdMapTree
+{
+public:
+    typedef typename map<Key, Value>::iterator iterator;
+
+    void insert(const pair<const Key, Value>& item) { items_[item.first] = item.second; }
+    void remove(const Key& key) { items_.erase(key); }
+    iterator find(const Key& key) { return items_.find(key); }
+    iterator begin() { return items_.begin(); }
+    iterator end() { return items_.end(); }
+
+private:
+    map<Key, Value> items_;
+};
+
+// Keys are generated from 64-bit numbers so every key type sees the same
+// sequence; strings are 16 hex digits, so their order matches the numbers.
+template<typename Key>
+struct KeyMaker;
+
+template<>
+struct KeyMaker<uint64_t>
+{
+    static const char* name() { return "int"; }
+    static uint64_t make(uint64_t x) { return x; }
+};
+
+template<>
+struct KeyMaker<string>
+{
+    static const char* name() { return "string"; }
+    static string make(uint64_t x)
+    {
+        char buf[17];
+        snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)x);
+        return string(buf);
+    }
+};
+
+struct Result
+{
+    string tree;
+    string keyType;
+    string workload;
+    uint64_t keys;
+    uint64_t ops;
+    double seconds;
+};
+
+static vector<Result> results;
+
+static void record(const char* tree, const char* keyType, const char* workload, uint64_t keys, uint64_t ops, double seconds)
+{
+    Result r = { tree, keyType, workload, keys, ops, seconds };
+    results.push_back(r);
+    // progress for long runs; the results go to stdout at the end
+    cerr << tree << " " << keyType << " " << workload << " " << keys << ": " << seconds << " s" << endl;
+}
+
+// Numbers shared by every tree for one size: distinct random keys (even,
+// so that odd numbers are guaranteed misses), their removal order and
+// Zipf-distributed picks among them.
+struct Workload
+{
+    vector<uint64_t> keys;
+    vector<uint64_t> removeOrder;
+    vector<uint64_t> zipf;
+    vector<uint64_t> misses;
+    vector<uint64_t> mixed;     // raw random draws for the mixed workloads
+};
+
+static void makeWorkload(uint64_t n, Workload& w)
+{
+    mt19937_64 rng(104 + n);
+    w.keys.resize(n);
+    for(uint64_t i = 0; i < n; ++i) {
+        w.keys[i] = rng() & ~1ULL;
+    }
+    sort(w.keys.begin(), w.keys.end());
+    w.keys.erase(unique(w.keys.begin(), w.keys.end()), w.keys.end());
+    while(w.keys.size() < n) {
+        w.keys.push_back(rng() & ~1ULL);
+    }
+    shuffle(w.keys.begin(), w.keys.end(), rng);
+    w.removeOrder = w.keys;
+    shuffle(w.removeOrder.begin(), w.removeOrder.end(), rng);
+
+    vector<double> cdf(n);
+    double total = 0;
+    for(uint64_t i = 0; i < n; ++i) {
+        total += 1.0 / pow((double)(i + 1), BST_COMPARE_ZIPF_EXPONENT);
+        cdf[i] = total;
+    }
+    uniform_real_distribution<double> uniform(0, total);
+    w.zipf.resize(n);
+    for(uint64_t i = 0; i < n; ++i) {
+        w.zipf[i] = w.keys[lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin()];
+    }
+
+    w.misses.resize(n);
+    for(uint64_t i = 0; i < n; ++i) {
+        w.misses[i] = rng() | 1;
+    }
+    w.mixed.resize(n);
+    for(uint64_t i = 0; i < n; ++i) {
+        w.mixed[i] = rng();
+    }
+}
+
+template<typename Tree, typename Key>
+static double fill(Tree& tree, const vector<uint64_t>& keys)
+{
+    vector<Key> made;
+    made.reserve(keys.size());
+    for(size_t i = 0; i < keys.size(); ++i) {
+        made.push_back(KeyMaker<Key>::make(keys[i]));
+    }
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < made.size(); ++i) {
+        tree.insert(std::make_pair(made[i], (uint64_t)i));
+    }
+    return secondsSince(start);
+}
+
+template<typename Tree, typename Key>
+static double lookups(Tree& tree, const vector<uint64_t>& probes)
+{
+    vector<Key> made;
+    made.reserve(probes.size());
+    for(size_t i = 0; i < probes.size(); ++i) {
+        made.push_back(KeyMaker<Key>::make(probes[i]));
+    }
+    uint64_t hits = 0;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < made.size(); ++i) {
+        hits += (tree.find(made[i]) != tree.end());
+    }
+    double elapsed = secondsSince(start);
+    if(hits == 1) {
+        cerr << "(1 hit)" << endl;     // keeps the loop from being optimized away
+    }
+    return elapsed;
+}
+
+// Mixed workload: readPercent% finds of present keys, the rest split
+// between inserting and removing random keys.
+template<typename Tree, typename Key>
+static double mixed(Tree& tree, const Workload& w, unsigned readPercent)
+{
+    uint64_t n = w.keys.size();
+    vector<Key> made;
+    made.reserve(n);
+    for(uint64_t i = 0; i < n; ++i) {
+        uint64_t r = w.mixed[i];
+        made.push_back(KeyMaker<Key>::make((r % 100 < readPercent) ? w.keys[(r >> 8) % n] : (r >> 8) & ~1ULL));
+    }
+    uint64_t hits = 0;
+    Clock::time_point start = Clock::now();
+    for(uint64_t i = 0; i < n; ++i) {
+        uint64_t r = w.mixed[i];
+        if(r % 100 < readPercent) {
+            hits += (tree.find(made[i]) != tree.end());
+        }
+        else if(r & 128) {
+            tree.insert(std::make_pair(made[i], i));
+        }
+        else {
+            tree.remove(made[i]);
+        }
+    }
+    double elapsed = secondsSince(start);
+    if(hits == 1) {
+        cerr << "(1 hit)" << endl;
+    }
+    return elapsed;
+}
+
+template<typename Tree, typename Key>
+static void runTree(const char* name, const Workload& w, bool degeneratesOnSorted)
+{
+    const char* keyType = KeyMaker<Key>::name();
+    uint64_t n = w.keys.size();
+
+    if(!degeneratesOnSorted || n <= BST_COMPARE_SEQ_LIMIT) {
+        vector<uint64_t> sorted(w.keys);
+        sort(sorted.begin(), sorted.end());
+        Tree tree;
+        record(name, keyType, "insert_seq", n, n, fill<Tree, Key>(tree, sorted));
+    }
+    {
+        Tree tree;
+        record(name, keyType, "insert_zipf", n, n, fill<Tree, Key>(tree, w.zipf));
+    }
+
+    Tree tree;
+    record(name, keyType, "insert_random", n, n, fill<Tree, Key>(tree, w.keys));
+    record(name, keyType, "find_hit", n, n, lookups<Tree, Key>(tree, w.removeOrder));
+    record(name, keyType, "find_miss", n, n, lookups<Tree, Key>(tree, w.misses));
+
+    uint64_t sum = 0;
+    Clock::time_point start = Clock::now();
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        sum += it->second;
+    }
+    record(name, keyType, "scan", n, n, secondsSince(start));
+    if(sum == 1) {
+        cerr << "(sum 1)" << endl;
+    }
+
+    record(name, keyType, "mixed_r90", n, n, mixed<Tree, Key>(tree, w, 90));
+    record(name, keyType, "mixed_r50", n, n, mixed<Tree, Key>(tree, w, 50));
+
+    Tree fresh;
+    fill<Tree, Key>(fresh, w.keys);
+    vector<Key> made;
+    made.reserve(n);
+    for(uint64_t i = 0; i < n; ++i) {
+        made.push_back(KeyMaker<Key>::make(w.removeOrder[i]));
+    }
+    start = Clock::now();
+    for(uint64_t i = 0; i < n; ++i) {
+        fresh.remove(made[i]);
+    }
+    record(name, keyType, "remove", n, n, secondsSince(start));
+}
+
+template<typename Key>
+static void runKeyType(const Workload& w)
+{
+    runTree<BinarySearchTree<Key, uint64_t>, Key>("BinarySearchTree", w, true);
+    runTree<AVLTree<Key, uint64_t>, Key>("AVLTree", w, false);
+    runTree<StdMapTree<Key, uint64_t>, Key>("std::map", w, false);
+}
+
+static void printCsv()
+{
+    cout << "tree,key_type,workload,keys,ops,seconds,ns_per_op" << endl;
+    for(size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        cout << r.tree << ',' << r.keyType << ',' << r.workload << ',' << r.keys << ',' << r.ops << ','
+             << r.seconds << ',' << r.seconds * 1e9 / r.ops << endl;
+    }
+}
+
+static void printJson()
+{
+    cout << "[" << endl;
+    for(size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        cout << "  {\"tree\": \"" << r.tree << "\", \"key_type\": \"" << r.keyType
+             << "\", \"workload\": \"" << r.workload << "\", \"keys\": " << r.keys
+             << ", \"ops\": " << r.ops << ", \"seconds\": " << r.seconds
+             << ", \"ns_per_op\": " << r.seconds * 1e9 / r.ops << "}"
+             << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    cout << "]" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    bool json = false;
+    vector<uint64_t> sizes;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--json") == 0) {
+            json = true;
+        }
+        else if(strncmp(argv[i], "--sizes=", 8) == 0) {
+            for(char* p = argv[i] + 8; *p != '\0'; ) {
+                sizes.push_back(strtoull(p, &p, 10));
+                if(*p == ',') {
+                    ++p;
+                }
+                else if(*p != '\0') {
+                    cerr << "bad size list: " << argv[i] << endl;
+                    return 1;
+                }
+            }
+        }
+        else {
+            cerr << "usage: " << argv[0] << " [--json] [--sizes=1000,10000,...]" << endl;
+            return 1;
+        }
+    }
+    if(sizes.empty()) {
+        // 10^7 and 10^8 are supported but need several GB of memory
+        const uint64_t defaults[] = { 1000, 10000, 100000, 1000000 };
+        sizes.assign(defaults, defaults + 4);
+    }
+
+    for(size_t i = 0; i < sizes.size(); ++i) {
+        if(sizes[i] == 0) {
+            continue;
+        }
+        Workload w;
+        makeWorkload(sizes[i], w);
+        runKeyType<uint64_t>(w);
+        runKeyType<string>(w);
+    }
+
+    if(json) {
+        printJson();
+    }
+    else {
+        printCsv();
+    }
+    return 0;
+}
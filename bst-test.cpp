@@ -2,6 +2,7 @@
 #include <map>
 #include "bst.h"
 #include "avlbst.h"
+#include "rbbst.h"
 
 using namespace std;
 
@@ -44,5 +45,29 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
+    // AVL set operations
+    AVLTree<char,int> other;
+    other.insert(std::make_pair('a',10));
+    other.insert(std::make_pair('c',3));
+    at.union_with(other);
+
+    cout << "\nAVLTree contents after union:" << endl;
+    for(AVLTree<char,int>::iterator it = at.begin(); it != at.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+
+    // Red-black Tree Tests
+    RedBlackTree<char,int> rt;
+    rt.insert(std::make_pair('a',1));
+    rt.insert(std::make_pair('b',2));
+    rt.insert(std::make_pair('c',3));
+
+    cout << "\nRedBlackTree contents:" << endl;
+    for(RedBlackTree<char,int>::iterator it = rt.begin(); it != rt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Erasing b" << endl;
+    rt.remove('b');
+
     return 0;
 }
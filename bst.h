@@ -3,8 +3,20 @@
 
 #include <iostream>
 #include <exception>
+#include <stdexcept>
 #include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
 #include <utility>
+#include <string>
+#include <vector>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "latency_histogram.h"
+#include "node_index.h"
+#include "bloom_filter.h"
 
 /**
  * A templated class for a Node in a search tree.
@@ -29,6 +41,9 @@ public:
     virtual Node<Key, Value>* getParent() const;
     virtual Node<Key, Value>* getLeft() const;
     virtual Node<Key, Value>* getRight() const;
+    // Trees with lazy deletion leave dead nodes (tombstones) in place
+    // until they compact; lookups and iteration skip them.
+    virtual bool isDead() const;
 
     void setParent(Node<Key, Value>* parent);
     void setLeft(Node<Key, Value>* left);
@@ -144,6 +159,12 @@ Node<Key, Value>* Node<Key, Value>::getRight() const
     return right_;
 }
 
+template<typename Key, typename Value>
+bool Node<Key, Value>::isDead() const
+{
+    return false;
+}
+
 /**
 * A setter for setting the parent of a node.
 */
@@ -186,6 +207,119 @@ void Node<Key, Value>::setValue(const Value& value)
   ---------------------------------------
 */
 
+/**
+* Operation counters returned by BinarySearchTree::stats().
+* They are only maintained when compiled with -DBST_STATS; otherwise
+* the counting code is compiled out and stats() returns zeros.
+* Counters are plain integers, only updated on the thread that called
+* into the tree. Set operations, whose recursion may run on helper
+* threads, count the nodes they free once the helpers are done and
+* nothing else.
+*/
+struct BSTStats
+{
+    uint64_t comparisons;      // nodes a search compared the key against
+    uint64_t finds;            // internalFind() calls
+    uint64_t findVisits;       // nodes visited by those finds
+    uint64_t singleRotations;  // fix-up steps with one rotation (zig-zig, splay zig)
+    uint64_t doubleRotations;  // fix-up steps with two rotations (zig-zag, splay zig-zig)
+    uint64_t nodeSwaps;
+    uint64_t allocations;      // nodes created
+    uint64_t frees;            // nodes deleted
+    uint64_t filterRejects;    // finds the Bloom filter answered without a search
+};
+
+#ifdef BST_STATS
+#define BST_COUNT(counter) (++this->stats_.counter)
+#else
+#define BST_COUNT(counter) ((void)0)
+#endif
+
+// Times the rest of the enclosing insert/remove/find into the matching
+// histogram while latency recording is enabled on the tree.
+#define BST_TIME(op) LatencyTimer latencyTimer_(this->latency_ != NULL ? &this->latency_->op : NULL)
+
+/**
+* Memory footprint returned by BinarySearchTree::memoryUsage(). The node
+* bytes are split into the key/value pair and the structure around it;
+* slack is what the allocator adds on top of each node (chunk headers
+* and size rounding). Heap memory owned by the keys or values themselves,
+* such as long std::string contents, is not included.
+*/
+struct BSTMemoryUsage
+{
+    uint64_t nodes;
+    uint64_t payloadBytes;     // std::pair<const Key, Value> in each node
+    uint64_t vtableBytes;      // vtable pointers
+    uint64_t pointerBytes;     // parent, left and right pointers
+    uint64_t balanceBytes;     // AVL balance or red-black color
+    uint64_t paddingBytes;     // alignment padding inside the nodes
+    uint64_t slackBytes;       // allocator overhead per node
+    uint64_t treeBytes;        // the tree object itself
+    uint64_t indexBytes;       // the hash index, if enabled
+    uint64_t filterBytes;      // the Bloom filter, if enabled
+
+    uint64_t totalBytes() const
+    {
+        return payloadBytes + vtableBytes + pointerBytes + balanceBytes + paddingBytes + slackBytes + treeBytes
+            + indexBytes + filterBytes;
+    }
+    double bytesPerEntry() const
+    {
+        return nodes ? (double)totalBytes() / nodes : 0;
+    }
+};
+
+// erase_if() calls that remove at least this many items may rebuild the
+// tree instead of deleting them one at a time.
+#define BST_ERASE_REBUILD_MIN 1024
+
+// Depth histogram buckets in BSTShape; nodes deeper than the last
+// bucket are counted in it.
+#define BST_SHAPE_MAX_DEPTH 64
+// Balance factors from -BST_SHAPE_BALANCE_RANGE to +BST_SHAPE_BALANCE_RANGE
+// get a bucket each; larger ones are counted in the end buckets.
+#define BST_SHAPE_BALANCE_RANGE 4
+// Left subtree heights the shape walk can hold for ancestors it is
+// still below (see BinarySearchTree::shape()).
+#define BST_SHAPE_STACK 256
+
+/**
+* Shape of a tree as measured by BinarySearchTree::shape(). Depth 0 is
+* the root, and a lookup that ends at depth d compares the key against
+* d + 1 nodes. A balance factor is right height minus left height.
+*/
+struct BSTShape
+{
+    uint64_t nodes;
+    int height;                    // 0 for an empty tree
+    uint64_t depthCounts[BST_SHAPE_MAX_DEPTH];
+    double meanHitPath;            // nodes compared by a successful find, averaged over the keys
+    double meanMissPath;           // nodes compared by a failed find, averaged over the gaps between keys
+    uint64_t balanceCounts[2 * BST_SHAPE_BALANCE_RANGE + 1];
+    bool balanceComplete;          // false if the walk ran out of stack and balanceCounts is empty
+
+    int maxPath() const { return height; }
+    uint64_t nodesWithBalance(int balance) const
+    {
+        balance = std::max(-BST_SHAPE_BALANCE_RANGE, std::min(BST_SHAPE_BALANCE_RANGE, balance));
+        return balanceCounts[balance + BST_SHAPE_BALANCE_RANGE];
+    }
+};
+
+// find_from() and lower_bound_from() give up on the hint and start from
+// the root once the climb from it passes this many levels: by then the
+// climb and the descent back cost more than a search from the top.
+#define BST_FINGER_MAX_CLIMB 8
+
+// False positive rate enableBloomFilter() sizes the filter for when none
+// is given.
+#define BST_BLOOM_FP_RATE 0.01
+
+// Weight balance kept by the scapegoat mode: no subtree may hold more
+// than this fraction of its parent's nodes after an insertion there.
+#define BST_SCAPEGOAT_ALPHA 0.7
+
 /**
 * A templated unbalanced binary search tree.
 */
@@ -197,10 +331,28 @@ public:
     virtual ~BinarySearchTree(); //TODO
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
-    void clear(); //TODO
+    virtual void clear(); //TODO
     bool isBalanced() const; //TODO
     void print() const;
     bool empty() const;
+    void save(const std::string& path) const;
+    virtual void load(const std::string& path);
+    void setScapegoat(bool enabled);
+    BSTStats stats() const;
+    void resetStats();
+    void enableLatency(bool enabled);
+    const BSTLatency* latency() const;
+    void resetLatency();
+    void enableHashIndex(bool enabled);
+    template<class Hash>
+    void enableHashIndex(bool enabled, const Hash& hash);
+    bool hashIndexed() const;
+    void enableBloomFilter(bool enabled, double falsePositiveRate = BST_BLOOM_FP_RATE);
+    template<class Hash>
+    void enableBloomFilter(bool enabled, double falsePositiveRate, const Hash& hash);
+    bool bloomFiltered() const;
+    BSTMemoryUsage memoryUsage() const;
+    BSTShape shape() const;
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
@@ -231,8 +383,18 @@ public:
     iterator begin() const;
     iterator end() const;
     iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    iterator find_from(iterator hint, const Key& key) const;
+    iterator lower_bound_from(iterator hint, const Key& key) const;
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
+    template<class Combine>
+    void upsert(const Key& key, const Value& value, Combine combine);
+    Value& getOrInsert(const Key& key);
+    iterator erase(iterator pos);
+    iterator erase(iterator first, iterator last);
+    template<class Predicate>
+    uint64_t erase_if(Predicate pred);
 
 protected:
     // Mandatory helper functions
@@ -240,6 +402,8 @@ protected:
     Node<Key, Value> *getSmallestNode() const;  // TODO
     static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
 		static Node<Key, Value>* successor(Node<Key, Value>* current); // TODO
+    // Lets derived trees return iterators to nodes they located themselves.
+    static iterator makeIterator(Node<Key, Value>* n);
 
     // Note:  static means these functions don't have a "this" pointer
     //        and instead just use the input argument.
@@ -248,14 +412,94 @@ protected:
     virtual void printRoot (Node<Key, Value> *r) const;
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
 
+    // Single-descent lookup-or-insert behind insert(), upsert() and
+    // getOrInsert(). Balanced trees override it to rebalance after
+    // inserting.
+    virtual Node<Key, Value>* findOrInsert(const Key& key, const Value& value, bool& inserted);
+    // Removal of a node the caller already holds, behind remove() and
+    // erase(). Balanced trees override it to rebalance afterwards.
+    virtual void eraseNode(Node<Key, Value>* n);
+    virtual void eraseRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    virtual void dropNodes(std::vector<Node<Key, Value>*>& keep, std::vector<Node<Key, Value>*>& doomed);
+    static Node<Key, Value>* firstLive(Node<Key, Value>* n);
+    // Finger search behind find_from() and lower_bound_from(): climb
+    // from a known node until its subtree spans the key, then descend.
+    Node<Key, Value>* fingerClimb(Node<Key, Value>* n, const Key& key, Node<Key, Value>*& bound) const;
+    Node<Key, Value>* lowerBoundNode(Node<Key, Value>* n, const Key& key, Node<Key, Value>* bound) const;
+    Node<Key, Value>* fingerSearch(iterator hint, const Key& key) const;
+
+    // Applies writes a derived tree holds back (see BufferedAVLTree).
+    // begin(), internalFind(), lower_bound(), the finger searches,
+    // empty() and erase_if() call it before reading the nodes. Returns
+    // true if it changed them, since a hint may then be gone. treeFind()
+    // is internalFind() without it, for trees that decide themselves
+    // when to apply their writes.
+    virtual bool flushPending() const;
+    Node<Key, Value>* treeFind(const Key& k) const;
+
+    // Node construction hooks used when building a tree in bulk (see load()).
+    // Derived trees override these to create their own node type and set
+    // its balance information from the subtree heights.
+    virtual Node<Key, Value>* makeNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void setBuiltHeights(Node<Key, Value>* n, int leftHeight, int rightHeight);
+    virtual bool rebalancesItself() const;
+    // Node layout, for memoryUsage(). Derived trees with their own node
+    // type report its size, the bytes of balance information it adds and
+    // the size of the tree object.
+    virtual size_t nodeBytes() const;
+    virtual size_t balanceBytes() const;
+    virtual size_t treeBytes() const;
+    template<typename Reader>
+    Node<Key, Value>* buildBalanced(Reader& in, uint64_t n, Node<Key, Value>* parent, int& height);
+
     // Add helper functions here
 	int isBalancedhelper(Node<Key, Value>* curr, bool& comp) const; 
 	void clearHelper(Node<Key, Value>* curr);
+	void removeNode(Node<Key, Value>* curr);
+
+    // Scapegoat mode helpers
+    void scapegoatInsert(Node<Key, Value>* n, int depth);
+    void scapegoatRemove();
+    void rebuild(Node<Key, Value>* n, uint64_t size);
+    static uint64_t subtreeSize(Node<Key, Value>* n);
+    void relinkAll(std::vector<Node<Key, Value>*>& nodes);
+    Node<Key, Value>* linkBuilt(std::vector<Node<Key, Value>*>& nodes, size_t lo, size_t hi, Node<Key, Value>* parent, int& height);
+
+    // Hash index and Bloom filter upkeep. Every path that allocates or
+    // frees a node calls indexInsert() or indexErase(); bulk paths that
+    // replace the node set call reindex() instead.
+    void indexInsert(Node<Key, Value>* n);
+    void indexErase(Node<Key, Value>* n);
+    void indexEraseSubtree(Node<Key, Value>* n);
+    void reindex();
+    void refilter();
 
 
 protected:
     Node<Key, Value>* root_;
     // You should not need other data members
+
+    // Scapegoat mode state. size_ and maxSize_ are only kept up to date
+    // by BinarySearchTree's own insert() and remove() while it is enabled.
+    bool scapegoat_;
+    uint64_t size_;
+    uint64_t maxSize_;
+
+    // Tombstones left by lazy deletion (see AVLTree::setLazyDelete()).
+    // While there are any, size_ counts them along with the live nodes.
+    uint64_t dead_;
+
+#ifdef BST_STATS
+    mutable BSTStats stats_;
+#endif
+
+    // Per-operation latency histograms, NULL unless enableLatency(true)
+    BSTLatency* latency_;
+
+    // Key to node hash table, NULL unless enableHashIndex(true)
+    NodeIndexBase<Key, Value>* index_;
+    // Bloom filter over the keys, NULL unless enableBloomFilter(true)
+    KeyFilterBase<Key>* filter_;
 };
 
 /*
@@ -279,7 +523,7 @@ BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
 template<class Key, class Value>
 BinarySearchTree<Key, Value>::iterator::iterator()
 {
-   current_ = getSmallestNode(); 
+   current_ = NULL;
 
 }
 
@@ -336,7 +580,7 @@ template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator&
 BinarySearchTree<Key, Value>::iterator::operator++()
 {
-		current_ = successor(current_);
+		current_ = firstLive(successor(current_));
 		return *this;
 
 }
@@ -361,12 +605,23 @@ template<class Key, class Value>
 BinarySearchTree<Key, Value>::BinarySearchTree() 
 {
     root_ = NULL;
+    scapegoat_ = false;
+    size_ = 0;
+    maxSize_ = 0;
+    dead_ = 0;
+    latency_ = NULL;
+    index_ = NULL;
+    filter_ = NULL;
+    resetStats();
 }
 
 template<typename Key, typename Value>
 BinarySearchTree<Key, Value>::~BinarySearchTree()
 {
     clear();
+    delete latency_;
+    delete index_;
+    delete filter_;
 
 }
 
@@ -376,7 +631,8 @@ BinarySearchTree<Key, Value>::~BinarySearchTree()
 template<class Key, class Value>
 bool BinarySearchTree<Key, Value>::empty() const
 {
-    return root_ == NULL;
+    flushPending();
+    return root_ == NULL || (dead_ > 0 && begin() == end());
 }
 
 template<typename Key, typename Value>
@@ -393,7 +649,8 @@ template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator
 BinarySearchTree<Key, Value>::begin() const
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
+    flushPending();
+    BinarySearchTree<Key, Value>::iterator begin(firstLive(getSmallestNode()));
     return begin;
 }
 
@@ -416,11 +673,167 @@ template<class Key, class Value>
 typename BinarySearchTree<Key, Value>::iterator
 BinarySearchTree<Key, Value>::find(const Key & k) const
 {
+    BST_TIME(find);
     Node<Key, Value> *curr = internalFind(k);
     BinarySearchTree<Key, Value>::iterator it(curr);
     return it;
 }
 
+/**
+* Returns an iterator to the first item whose key is not less than k,
+* or the end iterator if there is none.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::lower_bound(const Key& k) const
+{
+    BST_TIME(find);
+    BST_COUNT(finds);
+    flushPending();
+    return iterator(firstLive(lowerBoundNode(root_, k, NULL)));
+}
+
+/**
+* find() that starts from hint instead of the root. It climbs from the
+* hint only until the subtree there spans k, then descends, so a key d
+* positions away from the hint costs O(log d) in a balanced tree rather
+* than O(log n). Far keys fall back to a search from the root (see
+* BST_FINGER_MAX_CLIMB). hint must be an iterator into this tree; end()
+* also searches from the root.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::find_from(iterator hint, const Key& k) const
+{
+    BST_TIME(find);
+    BST_COUNT(finds);
+    if (flushPending()) {
+        hint = end();
+    }
+    Node<Key, Value>* n = fingerSearch(hint, k);
+    if (n == NULL || k < n -> getKey() || n -> isDead()) {
+        return end();
+    }
+    return iterator(n);
+}
+
+/**
+* lower_bound() that starts from hint, like find_from().
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::lower_bound_from(iterator hint, const Key& k) const
+{
+    BST_TIME(find);
+    BST_COUNT(finds);
+    if (flushPending()) {
+        hint = end();
+    }
+    return iterator(firstLive(fingerSearch(hint, k)));
+}
+
+/**
+* The climb from hint and descent behind find_from() and
+* lower_bound_from(). Returns the lowest node not below k, dead or not.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::fingerSearch(iterator hint, const Key& k) const
+{
+    Node<Key, Value>* bound = NULL;
+    Node<Key, Value>* start = (hint.current_ == NULL) ? NULL : fingerClimb(hint.current_, k, bound);
+    if (start == NULL) {
+        start = root_;
+    }
+    return lowerBoundNode(start, k, bound);
+}
+
+/**
+* Climbs from n to the lowest ancestor whose subtree holds every key
+* between n's key and k, and returns it. bound is set to the nearest
+* ancestor past that subtree with a larger key than k (the lower bound
+* if nothing in the subtree qualifies), or NULL. Returns NULL, with no
+* bound, if that ancestor is more than BST_FINGER_MAX_CLIMB levels up.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::fingerClimb(Node<Key, Value>* n, const Key& k, Node<Key, Value>*& bound) const
+{
+    bound = NULL;
+    if (n -> getKey() < k) {
+        // ends when n is the left child of a key above k
+        for (int levels = 0; n -> getParent() != NULL; ++levels) {
+            if (levels == BST_FINGER_MAX_CLIMB) {
+                return NULL;
+            }
+            BST_COUNT(findVisits);
+            BST_COUNT(comparisons);
+            Node<Key, Value>* p = n -> getParent();
+            if (n == p -> getLeft()) {
+                if (k < p -> getKey()) {
+                    bound = p;
+                    break;
+                }
+                if (!(p -> getKey() < k)) {
+                    return p;
+                }
+            }
+            n = p;
+        }
+    }
+    else if (k < n -> getKey()) {
+        // ends when n is the right child of a key below k; the hint
+        // itself is above k, so the lower bound lies inside the subtree
+        for (int levels = 0; n -> getParent() != NULL; ++levels) {
+            if (levels == BST_FINGER_MAX_CLIMB) {
+                return NULL;
+            }
+            BST_COUNT(findVisits);
+            BST_COUNT(comparisons);
+            Node<Key, Value>* p = n -> getParent();
+            if (n == p -> getRight()) {
+                if (p -> getKey() < k) {
+                    break;
+                }
+                if (!(k < p -> getKey())) {
+                    return p;
+                }
+            }
+            n = p;
+        }
+    }
+    return n;
+}
+
+/**
+* Descends from n to the smallest key in its subtree that is not less
+* than k, tombstones included. Returns bound if there is no such key.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::lowerBoundNode(Node<Key, Value>* n, const Key& k, Node<Key, Value>* bound) const
+{
+    while (n != NULL) {
+        BST_COUNT(findVisits);
+        BST_COUNT(comparisons);
+        if (n -> getKey() < k) {
+            n = n -> getRight();
+        }
+        else {
+            bound = n;
+            if (!(k < n -> getKey())) {
+                break;
+            }
+            n = n -> getLeft();
+        }
+    }
+    return bound;
+}
+
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::makeIterator(Node<Key, Value>* n)
+{
+    return iterator(n);
+}
+
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
@@ -449,45 +862,111 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 template<class Key, class Value>
 void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
 {
+    BST_TIME(insert);
+    bool inserted;
+    Node<Key, Value>* n = findOrInsert(keyValuePair.first, keyValuePair.second, inserted);
+    if(!inserted) {
+        n->setValue(keyValuePair.second);
+    }
+}
+
+/**
+* Merges value into the item with the given key, or inserts it if the
+* key is missing, in a single descent. The merged value is
+* combine(current value, value), so upsert(k, 1, std::plus<int>())
+* counts occurrences of k.
+*/
+template<class Key, class Value>
+template<class Combine>
+void BinarySearchTree<Key, Value>::upsert(const Key& key, const Value& value, Combine combine)
+{
+    BST_TIME(insert);
+    bool inserted;
+    Node<Key, Value>* n = findOrInsert(key, value, inserted);
+    if(!inserted) {
+        n->setValue(combine(n->getValue(), value));
+    }
+}
+
+/**
+* Returns the value associated with the key, inserting a
+* default-constructed value first if the key is missing (the behaviour
+* of std::map::operator[]; operator[] itself throws instead).
+*/
+template<class Key, class Value>
+Value& BinarySearchTree<Key, Value>::getOrInsert(const Key& key)
+{
+    BST_TIME(insert);
+    bool inserted;
+    return findOrInsert(key, Value(), inserted)->getValue();
+}
+
+/**
+* Descends once to the node with the given key. If there is none, a
+* node holding value is inserted (and the tree rebalanced) and inserted
+* is set. Either way the node is returned; its value is left alone if it
+* already existed.
+*/
+template<class Key, class Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::findOrInsert(const Key& key, const Value& value, bool& inserted)
+{
+	inserted = true;
 	//it tree is empty, assign new Node to root of tree
     if(root_ == NULL) {
-			root_ = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, NULL);
-			
+			root_ = new Node<Key, Value>(key, value, NULL);
+			BST_COUNT(allocations);
+			indexInsert(root_);
+			if (scapegoat_) {
+				scapegoatInsert(root_, 0);
+			}
+			return root_;
 		}
 
-    else {
-			//traverse through list to find place to insert node
-      Node<Key, Value>* curr = root_;
-      while(curr != NULL ) {
-				//if key is in tree, overwrite current value with updated value
-				if (keyValuePair.first == curr -> getKey()) {
-					curr -> setValue(keyValuePair.second);
-					return;
+		//traverse through list to find place to insert node
+    Node<Key, Value>* curr = root_;
+    int depth = 1;
+    while(true) {
+			BST_COUNT(comparisons);
+			//if key is in tree, return its node
+			if (key == curr -> getKey()) {
+				inserted = false;
+				return curr;
+      }
+			//if key < key of current node in traversal, either create new node with key and set it to the current node's left child 
+			//or continue traversing
+      else if (key < curr -> getKey()) {
+				if (curr -> getLeft() == NULL) {
+					Node<Key, Value>* temp = new Node<Key, Value>(key, value, curr);
+					curr -> setLeft(temp);
+					BST_COUNT(allocations);
+					indexInsert(temp);
+					if (scapegoat_) {
+						scapegoatInsert(temp, depth);
+					}
+					return temp;
         }
-				//if key < key of current node in traversal, either create new node with key and set it to the current node's left child 
-				//or continue traversing
-        else if (keyValuePair.first < curr -> getKey()) {
-					if (curr -> getLeft() == NULL) {
-						Node<Key, Value>* temp = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, curr);
-						curr -> setLeft(temp);
-						return;
-          }
-          else {
-						curr = curr -> getLeft(); 
-          }
+        else {
+					curr = curr -> getLeft(); 
+					depth++;
         }
-				//if key > key of current node in traversal, either create new node with key and set it to the current node's right child 
-				//or continue traversing
-        else if (keyValuePair.first > curr -> getKey())
-				{
-					if (curr -> getRight() == NULL) {
-						Node<Key, Value>* temp = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, curr);
-            curr -> setRight(temp);
-						return;
-          }
-					else {
-						curr = curr -> getRight(); }
+      }
+			//if key > key of current node in traversal, either create new node with key and set it to the current node's right child 
+			//or continue traversing
+      else
+			{
+				if (curr -> getRight() == NULL) {
+					Node<Key, Value>* temp = new Node<Key, Value>(key, value, curr);
+          curr -> setRight(temp);
+					BST_COUNT(allocations);
+					indexInsert(temp);
+					if (scapegoat_) {
+						scapegoatInsert(temp, depth);
+					}
+					return temp;
         }
+				else {
+					curr = curr -> getRight();
+					depth++; }
       }
     }
 }
@@ -501,13 +980,194 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::remove(const Key& key)
 {
+		BST_TIME(remove);
 		//find Node that possesses key value
 		Node<Key, Value>* curr = internalFind(key);
 		//returns if key value isn't in tree
 		if(curr == NULL) {
 			return;
 		}
+		eraseNode(curr);
+}
+
+/**
+* Removes the item the iterator points to and returns an iterator to the
+* item after it. The node is already known, so there is no search from
+* the root.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::erase(iterator pos)
+{
+    BST_TIME(remove);
+    Node<Key, Value>* n = pos.current_;
+    // rebalancing moves nodes around and compaction only frees dead
+    // ones, so the next live node found now is still next afterwards
+    Node<Key, Value>* next = firstLive(successor(n));
+    eraseNode(n);
+    return iterator(next);
+}
+
+/**
+* Removes the items in [first, last) and returns last, working from the
+* nodes the iterators hold.
+*/
+template<typename Key, typename Value>
+typename BinarySearchTree<Key, Value>::iterator
+BinarySearchTree<Key, Value>::erase(iterator first, iterator last)
+{
+    BST_TIME(remove);
+    if(first != last) {
+        eraseRange(first.current_, last.current_);
+    }
+    return last;
+}
+
+/**
+* Removes every item for which pred(item) is true and returns how many
+* were removed. The matches are scattered, so once there are enough of
+* them that k separate rebalancing deletes would cost more than a
+* rebuild (k log n > n), the surviving nodes are relinked into a
+* balanced tree in one O(n) pass instead.
+*/
+template<typename Key, typename Value>
+template<class Predicate>
+uint64_t BinarySearchTree<Key, Value>::erase_if(Predicate pred)
+{
+    flushPending();
+    std::vector<Node<Key, Value>*> keep;
+    std::vector<Node<Key, Value>*> doomed;
+    for(Node<Key, Value>* n = getSmallestNode(); n != NULL; n = successor(n)) {
+        if(!n->isDead() && pred(n->getItem())) {
+            doomed.push_back(n);
+        }
+        else {
+            keep.push_back(n);
+        }
+    }
+    uint64_t total = keep.size() + doomed.size();
+    if(doomed.size() >= BST_ERASE_REBUILD_MIN && doomed.size() * std::log2((double)total) > total) {
+        dropNodes(keep, doomed);
+    }
+    else {
+        for(size_t i = 0; i < doomed.size(); ++i) {
+            eraseNode(doomed[i]);
+        }
+    }
+    return doomed.size();
+}
+
+/**
+* Unlinks and deletes a node that is known to be in the tree, keeping
+* the tree's balance. Balanced trees override this with their own
+* delete-and-fix.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::eraseNode(Node<Key, Value>* n)
+{
+    removeNode(n);
+    if (scapegoat_) {
+        scapegoatRemove();
+    }
+}
+
+/**
+* Removes the nodes from first up to (not including) last, or to the
+* end if last is NULL, one eraseNode() at a time. The nodes of a range
+* are neighbours, so each delete only touches nodes the previous ones
+* already brought into cache; trees that can cut a range out in
+* O(log n) override this.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::eraseRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    while(first != last) {
+        Node<Key, Value>* next = firstLive(successor(first));
+        eraseNode(first);
+        first = next;
+    }
+}
+
+/**
+* Frees the doomed nodes and makes the in-order keep nodes the whole
+* tree. Trees that must not free nodes right away (lazy deletion)
+* override this.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::dropNodes(std::vector<Node<Key, Value>*>& keep, std::vector<Node<Key, Value>*>& doomed)
+{
+    for(size_t i = 0; i < doomed.size(); ++i) {
+        delete doomed[i];
+        BST_COUNT(frees);
+    }
+    relinkAll(keep);
+}
+
+/**
+* Returns n, or the first node after it that is not a tombstone.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::firstLive(Node<Key, Value>* n)
+{
+    while(n != NULL && n->isDead()) {
+        n = successor(n);
+    }
+    return n;
+}
+
+/**
+* Makes the in-order nodes the whole tree, linked perfectly balanced
+* with their balance information set through setBuiltHeights(), the way
+* load() builds a tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::relinkAll(std::vector<Node<Key, Value>*>& nodes)
+{
+    int height;
+    root_ = linkBuilt(nodes, 0, nodes.size(), NULL, height);
+    size_ = nodes.size();
+    maxSize_ = nodes.size();
+    if(index_ != NULL) {
+        index_->clear();
+        for(size_t i = 0; i < nodes.size(); ++i) {
+            index_->insert(nodes[i]);
+        }
+    }
+    if(filter_ != NULL) {
+        filter_->reset(nodes.size());
+        for(size_t i = 0; i < nodes.size(); ++i) {
+            filter_->insert(nodes[i]->getKey());
+        }
+    }
+}
 
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::linkBuilt(std::vector<Node<Key, Value>*>& nodes, size_t lo, size_t hi, Node<Key, Value>* parent, int& height)
+{
+    if(lo >= hi) {
+        height = 0;
+        return NULL;
+    }
+    // same split as buildBalanced(): the smaller half goes left
+    size_t mid = lo + (hi - lo - 1) / 2;
+    int leftHeight, rightHeight;
+    Node<Key, Value>* n = nodes[mid];
+    n->setParent(parent);
+    n->setLeft(linkBuilt(nodes, lo, mid, n, leftHeight));
+    n->setRight(linkBuilt(nodes, mid + 1, hi, n, rightHeight));
+    setBuiltHeights(n, leftHeight, rightHeight);
+    height = std::max(leftHeight, rightHeight) + 1;
+    return n;
+}
+
+/**
+* Unlinks and deletes a node that is known to be in the tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::removeNode(Node<Key, Value>* curr)
+{
+		BST_COUNT(frees);
+		indexErase(curr);
 		//swap with predecessor if node has two children
 		if (curr -> getLeft() != NULL && curr ->getRight() != NULL) {
 			nodeSwap(curr, predecessor(curr));
@@ -657,6 +1317,16 @@ BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
 template<typename Key, typename Value>
 void BinarySearchTree<Key, Value>::clear()
 {
+	size_ = 0;
+	maxSize_ = 0;
+	dead_ = 0;
+	if (index_ != NULL) {
+		index_->clear();
+	}
+	if (filter_ != NULL) {
+		filter_->reset(0);
+	}
+
 	//return if root = NULL
 	if (root_ == NULL) {
 		return; }
@@ -682,6 +1352,7 @@ void BinarySearchTree<Key, Value>::clearHelper(Node<Key, Value>* curr) {
 		clearHelper(curr -> getRight());
 		//delete curr
 		delete curr;
+		BST_COUNT(frees);
 	}
 	
 }
@@ -722,6 +1393,22 @@ BinarySearchTree<Key, Value>::getSmallestNode() const
 template<typename Key, typename Value>
 Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
 {
+    flushPending();
+    return treeFind(key);
+}
+
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::treeFind(const Key& key) const
+{
+		BST_COUNT(finds);
+		if (filter_ != NULL && !filter_->mayContain(key)) {
+			BST_COUNT(filterRejects);
+			return NULL;
+		}
+		if (index_ != NULL) {
+			Node<Key, Value>* n = index_->find(key);
+			return (n == NULL || n -> isDead()) ? NULL : n;
+		}
 		//set curr = to root
     Node<Key, Value>* curr = this -> root_;
 		if(curr == NULL) {
@@ -730,9 +1417,11 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) con
 		//traverse tree to find node, going left if key < current node's key
 		//and right if key > current node's key 
 		while(curr != NULL){
-		//return node when found
+		BST_COUNT(findVisits);
+		BST_COUNT(comparisons);
+		//return node when found (unless it is a tombstone)
 		if (curr -> getKey() == key) {
-			return curr;
+			return curr -> isDead() ? NULL : curr;
 		}
 		else if (key < curr -> getKey()) {
 			curr = curr -> getLeft();
@@ -845,6 +1534,7 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
     }
+    BST_COUNT(nodeSwaps);
     Node<Key, Value>* n1p = n1->getParent();
     Node<Key, Value>* n1r = n1->getRight();
     Node<Key, Value>* n1lt = n1->getLeft();
@@ -923,6 +1613,513 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
 
 }
 
+/**
+* Returns a snapshot of the operation counters (all zero unless the
+* tree was compiled with -DBST_STATS).
+*/
+template<typename Key, typename Value>
+BSTStats BinarySearchTree<Key, Value>::stats() const
+{
+#ifdef BST_STATS
+    return stats_;
+#else
+    BSTStats zero = BSTStats();
+    return zero;
+#endif
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::resetStats()
+{
+#ifdef BST_STATS
+    stats_ = BSTStats();
+#endif
+}
+
+/**
+* Turns per-operation latency recording on or off. While it is on,
+* every insert(), remove() and find() on the tree is timed into the
+* histograms returned by latency(); turning it off discards them.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::enableLatency(bool enabled)
+{
+    if(enabled && latency_ == NULL) {
+        latency_ = new BSTLatency;
+    }
+    else if(!enabled) {
+        delete latency_;
+        latency_ = NULL;
+    }
+}
+
+/**
+* Returns the latency histograms, or NULL if recording is off.
+*/
+template<typename Key, typename Value>
+const BSTLatency* BinarySearchTree<Key, Value>::latency() const
+{
+    return latency_;
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::resetLatency()
+{
+    if(latency_ != NULL) {
+        latency_->reset();
+    }
+}
+
+/**
+* Turns the hash index on or off. While it is on, find(), operator[]
+* and the other lookups by key go through an open-addressing table from
+* key to node in O(1) expected time instead of descending the tree;
+* iteration and range queries still use the tree. Inserts and removes
+* keep the table in step at the cost of one more probe each, and the
+* table adds 16 to 32 bytes per entry. Turning it on indexes the
+* current nodes in O(n). Keys need std::hash unless a hasher is passed.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::enableHashIndex(bool enabled)
+{
+    enableHashIndex(enabled, std::hash<Key>());
+}
+
+template<typename Key, typename Value>
+template<class Hash>
+void BinarySearchTree<Key, Value>::enableHashIndex(bool enabled, const Hash& hash)
+{
+    delete index_;
+    index_ = NULL;
+    if(enabled) {
+        index_ = new NodeIndex<Key, Value, Hash>(hash);
+        reindex();
+    }
+}
+
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::hashIndexed() const
+{
+    return index_ != NULL;
+}
+
+/**
+* Turns the Bloom filter on or off. While it is on, a lookup by key
+* first tests a blocked Bloom filter over the keys, one cache line per
+* probe, and a key the filter has never seen is reported absent without
+* searching. Keys present in the tree always pass; absent ones pass
+* with about falsePositiveRate probability once the filter is full.
+* Removed keys stay in the filter. It is rebuilt from the tree, O(n),
+* when it has taken twice the keys it was last sized for, or when
+* removed keys reach half of those added, so the upkeep is amortized
+* O(1) per insert. Turning it on builds it from the current nodes.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::enableBloomFilter(bool enabled, double falsePositiveRate)
+{
+    enableBloomFilter(enabled, falsePositiveRate, std::hash<Key>());
+}
+
+template<typename Key, typename Value>
+template<class Hash>
+void BinarySearchTree<Key, Value>::enableBloomFilter(bool enabled, double falsePositiveRate, const Hash& hash)
+{
+    delete filter_;
+    filter_ = NULL;
+    if(enabled) {
+        filter_ = new BlockedBloomFilter<Key, Hash>(falsePositiveRate, hash);
+        refilter();
+    }
+}
+
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::bloomFiltered() const
+{
+    return filter_ != NULL;
+}
+
+/**
+* Called with n already in the tree or about to be linked into it, so a
+* filter rebuild here adds n's key after walking the tree.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::indexInsert(Node<Key, Value>* n)
+{
+    if(index_ != NULL) {
+        index_->insert(n);
+    }
+    if(filter_ != NULL) {
+        if(filter_->needsRebuild()) {
+            refilter();
+        }
+        filter_->insert(n->getKey());
+    }
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::indexErase(Node<Key, Value>* n)
+{
+    if(index_ != NULL) {
+        index_->erase(n);
+    }
+    if(filter_ != NULL) {
+        filter_->erase(n->getKey());
+    }
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::indexEraseSubtree(Node<Key, Value>* n)
+{
+    if(n != NULL && (index_ != NULL || filter_ != NULL)) {
+        indexEraseSubtree(n->getLeft());
+        indexEraseSubtree(n->getRight());
+        indexErase(n);
+    }
+}
+
+/**
+* Rebuilds the hash index and the Bloom filter from the nodes in the
+* tree, tombstones included, O(n).
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::reindex()
+{
+    if(index_ != NULL) {
+        index_->clear();
+        for(Node<Key, Value>* n = getSmallestNode(); n != NULL; n = successor(n)) {
+            index_->insert(n);
+        }
+    }
+    refilter();
+}
+
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::refilter()
+{
+    if(filter_ != NULL) {
+        size_t keys = 0;
+        for(Node<Key, Value>* n = getSmallestNode(); n != NULL; n = successor(n)) {
+            ++keys;
+        }
+        filter_->reset(keys);
+        for(Node<Key, Value>* n = getSmallestNode(); n != NULL; n = successor(n)) {
+            filter_->insert(n->getKey());
+        }
+    }
+}
+
+/**
+* Walks the tree and reports how many bytes it takes. With glibc the
+* allocator slack is measured per node with malloc_usable_size();
+* elsewhere it is left at zero.
+*/
+template<typename Key, typename Value>
+BSTMemoryUsage BinarySearchTree<Key, Value>::memoryUsage() const
+{
+    BSTMemoryUsage usage = BSTMemoryUsage();
+    uint64_t slack = 0;
+    for(Node<Key, Value>* n = getSmallestNode(); n != NULL; n = successor(n)) {
+        ++usage.nodes;
+#ifdef __GLIBC__
+        // usable size plus the chunk header, less what the node asked for
+        slack += malloc_usable_size(n) + sizeof(size_t) - nodeBytes();
+#endif
+    }
+    usage.payloadBytes = usage.nodes * sizeof(std::pair<const Key, Value>);
+    usage.vtableBytes = usage.nodes * sizeof(void*);
+    usage.pointerBytes = usage.nodes * 3 * sizeof(Node<Key, Value>*);
+    usage.balanceBytes = usage.nodes * balanceBytes();
+    usage.paddingBytes = usage.nodes * nodeBytes() - usage.payloadBytes - usage.vtableBytes
+        - usage.pointerBytes - usage.balanceBytes;
+    usage.slackBytes = slack;
+    usage.treeBytes = treeBytes() + (latency_ != NULL ? sizeof(BSTLatency) : 0);
+    usage.indexBytes = (index_ != NULL) ? index_->bytes() : 0;
+    usage.filterBytes = (filter_ != NULL) ? filter_->bytes() : 0;
+    return usage;
+}
+
+/**
+* Profiles the shape of the tree in one O(n) walk that follows parent
+* pointers and allocates nothing, so it is safe to call on large trees
+* (unlike print()).
+*
+* Subtree heights for the balance factors are found bottom-up. While
+* the walk is in a right subtree it has to remember the left height of
+* that ancestor; it only does so for non-empty left subtrees, in a fixed
+* BST_SHAPE_STACK entry array. That covers any tree of height up to
+* BST_SHAPE_STACK and degenerate lists of any length. If the array does
+* overflow the balance counts are dropped (balanceComplete is false);
+* everything else is still exact.
+*/
+template<typename Key, typename Value>
+BSTShape BinarySearchTree<Key, Value>::shape() const
+{
+    BSTShape shape = BSTShape();
+    shape.balanceComplete = true;
+
+    uint64_t stackDepth[BST_SHAPE_STACK];
+    int stackHeight[BST_SHAPE_STACK];
+    int stackSize = 0;
+
+    uint64_t hitPathTotal = 0;
+    uint64_t missPathTotal = 0;
+    Node<Key, Value>* curr = root_;
+    uint64_t depth = 0;
+    int done = 0;   // height of the subtree the walk just finished
+    enum { DOWN, FROM_LEFT, FROM_RIGHT } state = DOWN;
+    while(curr != NULL) {
+        if(state == DOWN) {
+            ++shape.nodes;
+            ++shape.depthCounts[std::min(depth, (uint64_t)BST_SHAPE_MAX_DEPTH - 1)];
+            hitPathTotal += depth + 1;
+            if((int)depth + 1 > shape.height) {
+                shape.height = depth + 1;
+            }
+            if(curr->getLeft() != NULL) {
+                curr = curr->getLeft();
+                ++depth;
+                continue;
+            }
+            missPathTotal += depth + 1;
+            done = 0;
+            state = FROM_LEFT;
+        }
+        if(state == FROM_LEFT) {
+            if(done > 0) {
+                if(stackSize < BST_SHAPE_STACK) {
+                    stackDepth[stackSize] = depth;
+                    stackHeight[stackSize] = done;
+                    ++stackSize;
+                }
+                else {
+                    shape.balanceComplete = false;
+                }
+            }
+            if(curr->getRight() != NULL) {
+                curr = curr->getRight();
+                ++depth;
+                state = DOWN;
+                continue;
+            }
+            missPathTotal += depth + 1;
+            done = 0;
+        }
+        // both subtrees are done
+        int leftHeight = 0;
+        if(stackSize > 0 && stackDepth[stackSize - 1] == depth) {
+            leftHeight = stackHeight[--stackSize];
+        }
+        int balance = done - leftHeight;
+        balance = std::max(-BST_SHAPE_BALANCE_RANGE, std::min(BST_SHAPE_BALANCE_RANGE, balance));
+        ++shape.balanceCounts[balance + BST_SHAPE_BALANCE_RANGE];
+        done = 1 + std::max(leftHeight, done);
+
+        Node<Key, Value>* parent = curr->getParent();
+        state = (parent != NULL && parent->getLeft() == curr) ? FROM_LEFT : FROM_RIGHT;
+        curr = parent;
+        --depth;
+    }
+
+    if(!shape.balanceComplete) {
+        std::fill(shape.balanceCounts, shape.balanceCounts + 2 * BST_SHAPE_BALANCE_RANGE + 1, 0);
+    }
+    if(shape.nodes > 0) {
+        shape.meanHitPath = (double)hitPathTotal / shape.nodes;
+        shape.meanMissPath = (double)missPathTotal / (shape.nodes + 1);
+    }
+    return shape;
+}
+
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::nodeBytes() const
+{
+    return sizeof(Node<Key, Value>);
+}
+
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::balanceBytes() const
+{
+    return 0;
+}
+
+template<typename Key, typename Value>
+size_t BinarySearchTree<Key, Value>::treeBytes() const
+{
+    return sizeof(*this);
+}
+
+/**
+* Turns the scapegoat mode on or off. While it is on, insert() rebuilds
+* the highest subtree that lost its BST_SCAPEGOAT_ALPHA weight balance
+* whenever a new node lands deeper than log base 1/alpha of the size,
+* and remove() rebuilds the whole tree once it has shrunk below alpha
+* times its largest size. That keeps the height O(log n), amortized
+* O(log n) per update, without any per-node balance data.
+* Enabling it on a non-empty tree rebalances the tree first.
+*
+* Only plain BinarySearchTrees have the mode: the other engines insert
+* and remove through their own code and keep their own balance data,
+* which a scapegoat rebuild would leave stale. Enabling it on one of
+* them throws std::logic_error.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::setScapegoat(bool enabled)
+{
+    if(enabled && rebalancesItself()) {
+        throw std::logic_error("setScapegoat: the tree already rebalances itself");
+    }
+    scapegoat_ = enabled;
+    if(!enabled) {
+        return;
+    }
+    size_ = 0;
+    for(iterator it = begin(); it != end(); ++it) {
+        ++size_;
+    }
+    maxSize_ = size_;
+    if(root_ != NULL) {
+        rebuild(root_, size_);
+    }
+}
+
+/**
+* Bookkeeping after n was inserted at the given depth (root is 0).
+* Walks up from n, counting subtree sizes, until it finds an ancestor
+* whose child on the path is too heavy, and rebuilds that ancestor.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::scapegoatInsert(Node<Key, Value>* n, int depth)
+{
+    ++size_;
+    if(size_ > maxSize_) {
+        maxSize_ = size_;
+    }
+    if(depth <= std::log((double)size_) / std::log(1.0 / BST_SCAPEGOAT_ALPHA)) {
+        return;
+    }
+
+    Node<Key, Value>* child = n;
+    uint64_t childSize = 1;
+    Node<Key, Value>* p = n->getParent();
+    while(p != NULL) {
+        Node<Key, Value>* sibling = (child == p->getLeft()) ? p->getRight() : p->getLeft();
+        uint64_t size = 1 + childSize + subtreeSize(sibling);
+        if(childSize > BST_SCAPEGOAT_ALPHA * size) {
+            rebuild(p, size);
+            return;
+        }
+        child = p;
+        childSize = size;
+        p = p->getParent();
+    }
+}
+
+/**
+* Bookkeeping after a removal: rebuilds the whole tree once enough
+* nodes are gone that its height bound may no longer hold.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::scapegoatRemove()
+{
+    --size_;
+    if(size_ < BST_SCAPEGOAT_ALPHA * maxSize_) {
+        if(root_ != NULL) {
+            rebuild(root_, size_);
+        }
+        maxSize_ = size_;
+    }
+}
+
+/**
+* Relinks every node of the subtree rooted at n, which holds about size
+* nodes, into a perfectly balanced subtree in O(size) through
+* linkBuilt(). No nodes are allocated or freed.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::rebuild(Node<Key, Value>* n, uint64_t size)
+{
+    Node<Key, Value>* parent = n->getParent();
+    bool isLeft = (parent != NULL && parent->getLeft() == n);
+
+    // in-order walk of the whole subtree, stopping at its last node
+    std::vector<Node<Key, Value>*> nodes;
+    nodes.reserve(size);
+    Node<Key, Value>* last = n;
+    while(last->getRight() != NULL) {
+        last = last->getRight();
+    }
+    Node<Key, Value>* curr = n;
+    while(curr->getLeft() != NULL) {
+        curr = curr->getLeft();
+    }
+    while(true) {
+        nodes.push_back(curr);
+        if(curr == last) {
+            break;
+        }
+        curr = successor(curr);
+    }
+
+    int height;
+    Node<Key, Value>* top = linkBuilt(nodes, 0, nodes.size(), parent, height);
+    if(parent == NULL) {
+        root_ = top;
+    }
+    else if(isLeft) {
+        parent->setLeft(top);
+    }
+    else {
+        parent->setRight(top);
+    }
+}
+
+/**
+* Number of nodes in the subtree rooted at n.
+*/
+template<typename Key, typename Value>
+uint64_t BinarySearchTree<Key, Value>::subtreeSize(Node<Key, Value>* n)
+{
+    if(n == NULL) {
+        return 0;
+    }
+    return 1 + subtreeSize(n->getLeft()) + subtreeSize(n->getRight());
+}
+
+/**
+* Creates a node for bulk building. Plain BSTs use plain Nodes.
+*/
+template<typename Key, typename Value>
+Node<Key, Value>* BinarySearchTree<Key, Value>::makeNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    BST_COUNT(allocations);
+    return new Node<Key, Value>(key, value, parent);
+}
+
+/**
+* Plain BST nodes carry no balance information.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::setBuiltHeights(Node<Key, Value>* n, int leftHeight, int rightHeight)
+{
+
+}
+
+/**
+* True for engines that restructure the tree on their own updates and
+* so cannot take the scapegoat mode.
+*/
+template<typename Key, typename Value>
+bool BinarySearchTree<Key, Value>::rebalancesItself() const
+{
+    return false;
+}
+
+template<class Key, class Value>
+bool BinarySearchTree<Key, Value>::flushPending() const
+{
+    return false;
+}
+
 /**
  * Lastly, we are providing you with a print function,
    BinarySearchTree::printRoot().
@@ -937,6 +2134,9 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
 // include print function (in its own file because it's fairly long)
 #include "print_bst.h"
 
+// include snapshot save/load (also in its own file)
+#include "serialize_bst.h"
+
 /*
 ---------------------------------------------------
 End implementations for the BinarySearchTree class.
@@ -0,0 +1,522 @@
+#ifndef BUFFERED_AVLBST_H
+#define BUFFERED_AVLBST_H
+
+#include <iostream>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "avlbst.h"
+
+// Default number of buffered writes. 256 entries of a few words each
+// stay in L1/L2 while the buffer is searched and shifted.
+#define BUFFERED_AVL_CAPACITY 256
+
+/**
+* An AVLTree with an LSM-style write buffer in front of it.
+*
+* insert() and remove() only record the write in a small sorted array.
+* When it fills up, flush() applies all of it to the tree at once,
+* either as one insert or remove per key in key order, or as a single
+* linear merge of the buffer with the tree's nodes that relinks the
+* result perfectly balanced. get() reads the buffer first and then the
+* tree, so a write is visible to the next read. find() and the finger
+* searches only flush for a buffered key, and lower_bound() for a
+* buffered key at or past the one asked for.
+*
+* Every other read of the tree goes through flushPending(), which
+* flushes: begin() and so iteration, save() and tree images, empty(),
+* erase_if(), compact(), the set operations, and the lookups above when
+* they are reached through a const tree or a base class reference.
+* load() and clear() drop the buffer.
+*/
+template <typename Key, typename Value>
+class BufferedAVLTree : public AVLTree<Key, Value>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value>::iterator iterator;
+
+    // How flush() applies the buffer: per key, by relinking the whole
+    // tree, or whichever of the two is cheaper (B log n against n).
+    enum MergePolicy { MERGE_AUTO, MERGE_INSERT, MERGE_REBUILD };
+
+    BufferedAVLTree();
+
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    bool get(const Key& key, Value& value) const;
+    using AVLTree<Key, Value>::find;
+    using AVLTree<Key, Value>::lower_bound;
+    using AVLTree<Key, Value>::find_from;
+    using AVLTree<Key, Value>::lower_bound_from;
+    using AVLTree<Key, Value>::operator[];
+    iterator find(const Key& key);
+    iterator lower_bound(const Key& key);
+    iterator find_from(iterator hint, const Key& key);
+    iterator lower_bound_from(iterator hint, const Key& key);
+    Value& operator[](const Key& key);
+    template<class InputIterator>
+    void insert_batch(InputIterator first, InputIterator last);
+    virtual void clear();
+    virtual void load(const std::string& path);
+
+    void flush();
+    void setBufferCapacity(size_t entries);
+    void setMergePolicy(MergePolicy policy);
+    size_t buffered() const;
+    uint64_t flushes() const;
+
+protected:
+    // A pending write; erased marks a buffered remove.
+    struct Entry
+    {
+        Key key;
+        Value value;
+        bool erased;
+    };
+    struct EntryLess
+    {
+        bool operator()(const Entry& e, const Key& key) const { return e.key < key; }
+    };
+
+    typename std::vector<Entry>::iterator lookup(const Key& key);
+    typename std::vector<Entry>::const_iterator lookup(const Key& key) const;
+    void mergeInsert(std::vector<Entry>& pending);
+    void mergeRebuild(std::vector<Entry>& pending);
+
+    // These keep treeSize_ right whichever way the tree changes, and
+    // drop buffered writes that an erase of a tree node supersedes.
+    virtual Node<Key, Value>* findOrInsert(const Key& key, const Value& value, bool& inserted);
+    virtual void eraseNode(Node<Key, Value>* node);
+    virtual void eraseRange(Node<Key, Value>* first, Node<Key, Value>* last);
+    virtual void dropNodes(std::vector<Node<Key, Value>*>& keep, std::vector<Node<Key, Value>*>& doomed);
+    virtual size_t treeBytes() const;
+
+    // A set operation moves nodes between the trees without going
+    // through the hooks above, so treeSize_ is counted again afterwards.
+    virtual bool flushPending() const;
+    virtual void setOpDone();
+
+    std::vector<Entry> buffer_;     // sorted by key, at most one entry per key
+    size_t capacity_;
+    MergePolicy policy_;
+    uint64_t treeSize_;             // live items in the tree, not counting the buffer
+    uint64_t flushes_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the BufferedAVLTree class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value>
+BufferedAVLTree<Key, Value>::BufferedAVLTree() :
+    capacity_(BUFFERED_AVL_CAPACITY), policy_(MERGE_AUTO), treeSize_(0), flushes_(0)
+{
+    buffer_.reserve(capacity_);
+}
+
+/**
+* Records the write in the buffer, replacing any earlier buffered write
+* of the same key, and flushes once the buffer is full.
+*/
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    BST_TIME(insert);
+    typename std::vector<Entry>::iterator it = lookup(keyValuePair.first);
+    if (it != buffer_.end() && it -> key == keyValuePair.first) {
+        it -> value = keyValuePair.second;
+        it -> erased = false;
+        return;
+    }
+    Entry e = { keyValuePair.first, keyValuePair.second, false };
+    buffer_.insert(it, e);
+    if (buffer_.size() >= capacity_) {
+        flush();
+    }
+}
+
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::remove(const Key& key)
+{
+    BST_TIME(remove);
+    typename std::vector<Entry>::iterator it = lookup(key);
+    if (it != buffer_.end() && it -> key == key) {
+        it -> erased = true;
+        return;
+    }
+    Entry e = { key, Value(), true };
+    buffer_.insert(it, e);
+    if (buffer_.size() >= capacity_) {
+        flush();
+    }
+}
+
+/**
+* Copies the current value of key into value and returns true, or
+* returns false if the key is absent. Never flushes.
+*/
+template<class Key, class Value>
+bool BufferedAVLTree<Key, Value>::get(const Key& key, Value& value) const
+{
+    typename std::vector<Entry>::const_iterator it = lookup(key);
+    if (it != buffer_.end() && it -> key == key) {
+        if (it -> erased) {
+            return false;
+        }
+        value = it -> value;
+        return true;
+    }
+    Node<Key, Value>* n = this -> treeFind(key);
+    if (n == NULL) {
+        return false;
+    }
+    value = n -> getValue();
+    return true;
+}
+
+/**
+* Returns a tree iterator to key. Only a buffered key forces a flush;
+* any other key is looked up in the tree as it is.
+*/
+template<class Key, class Value>
+typename BufferedAVLTree<Key, Value>::iterator BufferedAVLTree<Key, Value>::find(const Key& key)
+{
+    BST_TIME(find);
+    typename std::vector<Entry>::iterator it = lookup(key);
+    if (it != buffer_.end() && it -> key == key) {
+        flush();
+    }
+    return BinarySearchTree<Key, Value>::makeIterator(this -> treeFind(key));
+}
+
+/**
+* Flushes only if some buffered key is at or past key, since only those
+* can change the answer.
+*/
+template<class Key, class Value>
+typename BufferedAVLTree<Key, Value>::iterator BufferedAVLTree<Key, Value>::lower_bound(const Key& key)
+{
+    BST_TIME(find);
+    BST_COUNT(finds);
+    if (lookup(key) != buffer_.end()) {
+        flush();
+    }
+    return BinarySearchTree<Key, Value>::makeIterator(
+        BinarySearchTree<Key, Value>::firstLive(this -> lowerBoundNode(this -> root_, key, NULL)));
+}
+
+/**
+* Finger searches from hint when key is not buffered. Otherwise the
+* flush may have freed the hint's node, so the search starts from the
+* root.
+*/
+template<class Key, class Value>
+typename BufferedAVLTree<Key, Value>::iterator BufferedAVLTree<Key, Value>::find_from(iterator hint, const Key& key)
+{
+    BST_TIME(find);
+    BST_COUNT(finds);
+    typename std::vector<Entry>::iterator it = lookup(key);
+    if (it != buffer_.end() && it -> key == key) {
+        flush();
+        hint = this -> end();
+    }
+    Node<Key, Value>* n = this -> fingerSearch(hint, key);
+    if (n == NULL || key < n -> getKey() || n -> isDead()) {
+        return this -> end();
+    }
+    return BinarySearchTree<Key, Value>::makeIterator(n);
+}
+
+template<class Key, class Value>
+typename BufferedAVLTree<Key, Value>::iterator BufferedAVLTree<Key, Value>::lower_bound_from(iterator hint, const Key& key)
+{
+    BST_TIME(find);
+    BST_COUNT(finds);
+    if (lookup(key) != buffer_.end()) {
+        flush();
+        hint = this -> end();
+    }
+    return BinarySearchTree<Key, Value>::makeIterator(
+        BinarySearchTree<Key, Value>::firstLive(this -> fingerSearch(hint, key)));
+}
+
+template<class Key, class Value>
+Value& BufferedAVLTree<Key, Value>::operator[](const Key& key)
+{
+    iterator it = find(key);
+    if (it == this -> end()) throw std::out_of_range("Invalid key");
+    return it -> second;
+}
+
+/**
+* Goes through the buffer like any other write; the flushes already
+* apply the keys in batches.
+*/
+template<class Key, class Value>
+template<class InputIterator>
+void BufferedAVLTree<Key, Value>::insert_batch(InputIterator first, InputIterator last)
+{
+    for (; first != last; ++first) {
+        insert(std::make_pair(first -> first, first -> second));
+    }
+}
+
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::clear()
+{
+    buffer_.clear();
+    treeSize_ = 0;
+    AVLTree<Key, Value>::clear();
+}
+
+/**
+* Replaces the contents with a snapshot, dropping any buffered writes.
+* Like BinarySearchTree::load(), leaves the tree and the buffer alone if
+* the file cannot be read.
+*/
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::load(const std::string& path)
+{
+    // the base load() empties the tree through clear(), which drops the
+    // buffer, and leaves the item count in size_
+    AVLTree<Key, Value>::load(path);
+    treeSize_ = this -> size_;
+}
+
+/**
+* Applies every buffered write to the tree and empties the buffer.
+*/
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::flush()
+{
+    if (buffer_.empty()) {
+        return;
+    }
+    // take the writes out first: applying them goes through
+    // findOrInsert() and eraseNode(), which look at buffer_
+    std::vector<Entry> pending;
+    pending.swap(buffer_);
+    buffer_.reserve(capacity_);
+    ++flushes_;
+
+    bool rebuild = (policy_ == MERGE_REBUILD);
+    if (policy_ == MERGE_AUTO) {
+        double n = (double)treeSize_;
+        rebuild = pending.size() * std::log2(n + 2) > n;
+    }
+    if (rebuild) {
+        mergeRebuild(pending);
+    }
+    else {
+        mergeInsert(pending);
+    }
+}
+
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::setBufferCapacity(size_t entries)
+{
+    capacity_ = (entries > 0) ? entries : 1;
+    if (buffer_.size() >= capacity_) {
+        flush();
+    }
+    buffer_.reserve(capacity_);
+}
+
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::setMergePolicy(MergePolicy policy)
+{
+    policy_ = policy;
+}
+
+template<class Key, class Value>
+size_t BufferedAVLTree<Key, Value>::buffered() const
+{
+    return buffer_.size();
+}
+
+template<class Key, class Value>
+uint64_t BufferedAVLTree<Key, Value>::flushes() const
+{
+    return flushes_;
+}
+
+template<class Key, class Value>
+typename std::vector<typename BufferedAVLTree<Key, Value>::Entry>::iterator
+BufferedAVLTree<Key, Value>::lookup(const Key& key)
+{
+    return std::lower_bound(buffer_.begin(), buffer_.end(), key, EntryLess());
+}
+
+template<class Key, class Value>
+typename std::vector<typename BufferedAVLTree<Key, Value>::Entry>::const_iterator
+BufferedAVLTree<Key, Value>::lookup(const Key& key) const
+{
+    return std::lower_bound(buffer_.begin(), buffer_.end(), key, EntryLess());
+}
+
+/**
+* One ordinary insert or remove per pending write. Going in key order
+* keeps the upper levels of the tree in cache from one write to the next.
+*/
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::mergeInsert(std::vector<Entry>& pending)
+{
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (pending[i].erased) {
+            Node<Key, Value>* n = this -> internalFind(pending[i].key);
+            if (n != NULL) {
+                eraseNode(n);
+            }
+        }
+        else {
+            bool inserted;
+            Node<Key, Value>* n = findOrInsert(pending[i].key, pending[i].value, inserted);
+            if (!inserted) {
+                n -> setValue(pending[i].value);
+            }
+        }
+    }
+}
+
+/**
+* Merges the pending writes with the tree's nodes in one in-order pass
+* and relinks the result perfectly balanced, O(n + B) with no rotations.
+*/
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::mergeRebuild(std::vector<Entry>& pending)
+{
+    if (this -> dead_ > 0) {
+        this -> compact();
+    }
+    // collect first: successor() climbs through parents, which may be
+    // among the nodes freed below
+    std::vector<Node<Key, Value>*> nodes;
+    nodes.reserve(treeSize_);
+    for (Node<Key, Value>* n = this -> getSmallestNode(); n != NULL; n = BinarySearchTree<Key, Value>::successor(n)) {
+        nodes.push_back(n);
+    }
+    std::vector<Node<Key, Value>*> merged;
+    merged.reserve(nodes.size() + pending.size());
+    size_t j = 0;
+    size_t i = 0;
+    while (j < nodes.size() || i < pending.size()) {
+        if (i == pending.size() || (j < nodes.size() && nodes[j] -> getKey() < pending[i].key)) {
+            merged.push_back(nodes[j++]);
+        }
+        else if (j < nodes.size() && nodes[j] -> getKey() == pending[i].key) {
+            if (pending[i].erased) {
+                delete nodes[j];
+                BST_COUNT(frees);
+            }
+            else {
+                nodes[j] -> setValue(pending[i].value);
+                merged.push_back(nodes[j]);
+            }
+            ++j;
+            ++i;
+        }
+        else {
+            if (!pending[i].erased) {
+                merged.push_back(this -> makeNode(pending[i].key, pending[i].value, NULL));
+            }
+            ++i;
+        }
+    }
+    this -> relinkAll(merged);
+    treeSize_ = merged.size();
+}
+
+template<class Key, class Value>
+Node<Key, Value>* BufferedAVLTree<Key, Value>::findOrInsert(const Key& key, const Value& value, bool& inserted)
+{
+    // upsert() and getOrInsert() read the current value, so they must
+    // see every buffered write first
+    flush();
+    Node<Key, Value>* n = AVLTree<Key, Value>::findOrInsert(key, value, inserted);
+    if (inserted) {
+        ++treeSize_;
+    }
+    return n;
+}
+
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::eraseNode(Node<Key, Value>* node)
+{
+    typename std::vector<Entry>::iterator it = lookup(node -> getKey());
+    if (it != buffer_.end() && it -> key == node -> getKey()) {
+        buffer_.erase(it);
+    }
+    --treeSize_;
+    AVLTree<Key, Value>::eraseNode(node);
+}
+
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::eraseRange(Node<Key, Value>* first, Node<Key, Value>* last)
+{
+    typename std::vector<Entry>::iterator from = lookup(first -> getKey());
+    typename std::vector<Entry>::iterator to = (last != NULL) ? lookup(last -> getKey()) : buffer_.end();
+    buffer_.erase(from, to);
+    // a lazy AVLTree hands the range back to eraseNode() one node at a time
+    for (Node<Key, Value>* n = first; n != last; n = BinarySearchTree<Key, Value>::firstLive(BinarySearchTree<Key, Value>::successor(n))) {
+        if (!this -> lazy_) {
+            --treeSize_;
+        }
+    }
+    AVLTree<Key, Value>::eraseRange(first, last);
+}
+
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::dropNodes(std::vector<Node<Key, Value>*>& keep, std::vector<Node<Key, Value>*>& doomed)
+{
+    // only reached from erase_if(), which flushed first; a lazy
+    // AVLTree tombstones the doomed nodes through eraseNode() instead
+    if (!this -> lazy_) {
+        treeSize_ -= doomed.size();
+    }
+    AVLTree<Key, Value>::dropNodes(keep, doomed);
+}
+
+template<class Key, class Value>
+size_t BufferedAVLTree<Key, Value>::treeBytes() const
+{
+    return sizeof(*this) + buffer_.capacity() * sizeof(Entry);
+}
+
+/**
+* Flushes for the base class read paths, which are const. Flushing only
+* moves the writes into the tree and leaves the contents as they were.
+*/
+template<class Key, class Value>
+bool BufferedAVLTree<Key, Value>::flushPending() const
+{
+    if (buffer_.empty()) {
+        return false;
+    }
+    const_cast<BufferedAVLTree<Key, Value>*>(this) -> flush();
+    return true;
+}
+
+template<class Key, class Value>
+void BufferedAVLTree<Key, Value>::setOpDone()
+{
+    treeSize_ = 0;
+    for (Node<Key, Value>* n = this -> getSmallestNode(); n != NULL; n = BinarySearchTree<Key, Value>::successor(n)) {
+        if (!n -> isDead()) {
+            ++treeSize_;
+        }
+    }
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the BufferedAVLTree class.
+  -------------------------------------------------
+*/
+
+#endif
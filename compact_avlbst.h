@@ -0,0 +1,562 @@
+#ifndef COMPACT_AVLBST_H
+#define COMPACT_AVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+// index used for "no node"; parent links only have 30 bits
+#define COMPACT_NIL 0x3FFFFFFFu
+
+/**
+* An AVL tree whose nodes live in one contiguous vector and refer to
+* each other by 32-bit indices. There is no vtable, and the balance is
+* packed into the top two bits of the parent index, so a
+* CompactAVLTree<uint64_t, uint64_t> node is 32 bytes instead of an
+* allocator-rounded AVLNode of 64.
+*
+* It offers the same interface as BinarySearchTree/AVLTree. Removing
+* moves the last node into the freed slot to keep the storage dense, so
+* remove() invalidates iterators and pointers into the tree.
+*/
+template <typename Key, typename Value>
+class CompactAVLTree
+{
+public:
+    CompactAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    void reserve(size_t n);
+    bool empty() const;
+    size_t size() const;
+    size_t memoryBytes() const;
+
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key, Value>& operator*() const;
+        std::pair<const Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class CompactAVLTree<Key, Value>;
+        iterator(const CompactAVLTree<Key, Value>* tree, uint32_t index);
+        const CompactAVLTree<Key, Value>* tree_;
+        uint32_t current_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    struct CompactNode
+    {
+        CompactNode(const Key& key, const Value& value, uint32_t parent);
+
+        std::pair<const Key, Value> item;
+        uint32_t left;
+        uint32_t right;
+        uint32_t parentBalance;     // parent index in the low 30 bits, balance + 1 in the top 2
+    };
+
+    uint32_t getParent(uint32_t n) const;
+    void setParent(uint32_t n, uint32_t parent);
+    int getBalance(uint32_t n) const;
+    void setBalance(uint32_t n, int balance);
+
+    uint32_t internalFind(const Key& key) const;
+    uint32_t successor(uint32_t n) const;
+    void replaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild);
+    void rotateLeft(uint32_t n);
+    void rotateRight(uint32_t n);
+    uint32_t rebalanceRight(uint32_t n, bool& shrunk);
+    uint32_t rebalanceLeft(uint32_t n, bool& shrunk);
+    void insertFix(uint32_t n);
+    void removeFix(uint32_t p, bool leftShrunk);
+    void relocate(uint32_t from, uint32_t to);
+
+    mutable std::vector<CompactNode> nodes_;
+    uint32_t root_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the CompactAVLTree::iterator class.
+  -----------------------------------------------
+*/
+
+template<class Key, class Value>
+CompactAVLTree<Key, Value>::iterator::iterator() :
+    tree_(NULL),
+    current_(COMPACT_NIL)
+{
+
+}
+
+template<class Key, class Value>
+CompactAVLTree<Key, Value>::iterator::iterator(const CompactAVLTree<Key, Value>* tree, uint32_t index) :
+    tree_(tree),
+    current_(index)
+{
+
+}
+
+template<class Key, class Value>
+std::pair<const Key, Value>& CompactAVLTree<Key, Value>::iterator::operator*() const
+{
+    return tree_->nodes_[current_].item;
+}
+
+template<class Key, class Value>
+std::pair<const Key, Value>* CompactAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(tree_->nodes_[current_].item);
+}
+
+template<class Key, class Value>
+bool CompactAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<class Key, class Value>
+bool CompactAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+template<class Key, class Value>
+typename CompactAVLTree<Key, Value>::iterator& CompactAVLTree<Key, Value>::iterator::operator++()
+{
+    current_ = tree_->successor(current_);
+    return *this;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the CompactAVLTree::iterator class.
+  -----------------------------------------------
+*/
+
+/*
+  -----------------------------------------------
+  Begin implementations for the CompactAVLTree class.
+  -----------------------------------------------
+*/
+
+template<class Key, class Value>
+CompactAVLTree<Key, Value>::CompactNode::CompactNode(const Key& key, const Value& value, uint32_t parent) :
+    item(key, value),
+    left(COMPACT_NIL),
+    right(COMPACT_NIL),
+    parentBalance(parent | (1u << 30))
+{
+
+}
+
+template<class Key, class Value>
+CompactAVLTree<Key, Value>::CompactAVLTree() :
+    root_(COMPACT_NIL)
+{
+
+}
+
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::getParent(uint32_t n) const
+{
+    return nodes_[n].parentBalance & COMPACT_NIL;
+}
+
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::setParent(uint32_t n, uint32_t parent)
+{
+    nodes_[n].parentBalance = (nodes_[n].parentBalance & ~COMPACT_NIL) | parent;
+}
+
+template<class Key, class Value>
+int CompactAVLTree<Key, Value>::getBalance(uint32_t n) const
+{
+    return (int)(nodes_[n].parentBalance >> 30) - 1;
+}
+
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::setBalance(uint32_t n, int balance)
+{
+    nodes_[n].parentBalance = (nodes_[n].parentBalance & COMPACT_NIL) | ((uint32_t)(balance + 1) << 30);
+}
+
+template<class Key, class Value>
+bool CompactAVLTree<Key, Value>::empty() const
+{
+    return root_ == COMPACT_NIL;
+}
+
+template<class Key, class Value>
+size_t CompactAVLTree<Key, Value>::size() const
+{
+    return nodes_.size();
+}
+
+/**
+* Bytes held by the tree, including unused vector capacity.
+*/
+template<class Key, class Value>
+size_t CompactAVLTree<Key, Value>::memoryBytes() const
+{
+    return sizeof(*this) + nodes_.capacity() * sizeof(CompactNode);
+}
+
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::reserve(size_t n)
+{
+    nodes_.reserve(n);
+}
+
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::clear()
+{
+    nodes_.clear();
+    root_ = COMPACT_NIL;
+}
+
+template<class Key, class Value>
+typename CompactAVLTree<Key, Value>::iterator CompactAVLTree<Key, Value>::begin() const
+{
+    uint32_t curr = root_;
+    while(curr != COMPACT_NIL && nodes_[curr].left != COMPACT_NIL) {
+        curr = nodes_[curr].left;
+    }
+    return iterator(this, curr);
+}
+
+template<class Key, class Value>
+typename CompactAVLTree<Key, Value>::iterator CompactAVLTree<Key, Value>::end() const
+{
+    return iterator(this, COMPACT_NIL);
+}
+
+template<class Key, class Value>
+typename CompactAVLTree<Key, Value>::iterator CompactAVLTree<Key, Value>::find(const Key& key) const
+{
+    return iterator(this, internalFind(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& CompactAVLTree<Key, Value>::operator[](const Key& key)
+{
+    uint32_t curr = internalFind(key);
+    if(curr == COMPACT_NIL) throw std::out_of_range("Invalid key");
+    return nodes_[curr].item.second;
+}
+
+template<class Key, class Value>
+Value const & CompactAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    uint32_t curr = internalFind(key);
+    if(curr == COMPACT_NIL) throw std::out_of_range("Invalid key");
+    return nodes_[curr].item.second;
+}
+
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    uint32_t curr = root_;
+    while(curr != COMPACT_NIL) {
+        const CompactNode& n = nodes_[curr];
+        if(key == n.item.first) {
+            return curr;
+        }
+        curr = (key < n.item.first) ? n.left : n.right;
+    }
+    return COMPACT_NIL;
+}
+
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::successor(uint32_t n) const
+{
+    if(nodes_[n].right != COMPACT_NIL) {
+        n = nodes_[n].right;
+        while(nodes_[n].left != COMPACT_NIL) {
+            n = nodes_[n].left;
+        }
+        return n;
+    }
+    uint32_t p = getParent(n);
+    while(p != COMPACT_NIL && n == nodes_[p].right) {
+        n = p;
+        p = getParent(p);
+    }
+    return p;
+}
+
+/**
+* Points whichever link of parent referred to oldChild (or the root) at newChild.
+*/
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::replaceChild(uint32_t parent, uint32_t oldChild, uint32_t newChild)
+{
+    if(parent == COMPACT_NIL) {
+        root_ = newChild;
+    }
+    else if(nodes_[parent].left == oldChild) {
+        nodes_[parent].left = newChild;
+    }
+    else {
+        nodes_[parent].right = newChild;
+    }
+    if(newChild != COMPACT_NIL) {
+        setParent(newChild, parent);
+    }
+}
+
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::rotateLeft(uint32_t n)
+{
+    uint32_t c = nodes_[n].right;
+    uint32_t inner = nodes_[c].left;
+    replaceChild(getParent(n), n, c);
+    nodes_[n].right = inner;
+    if(inner != COMPACT_NIL) setParent(inner, n);
+    nodes_[c].left = n;
+    setParent(n, c);
+}
+
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::rotateRight(uint32_t n)
+{
+    uint32_t c = nodes_[n].left;
+    uint32_t inner = nodes_[c].right;
+    replaceChild(getParent(n), n, c);
+    nodes_[n].left = inner;
+    if(inner != COMPACT_NIL) setParent(inner, n);
+    nodes_[c].right = n;
+    setParent(n, c);
+}
+
+/**
+* Fixes n when its right side is two levels taller. Returns the new
+* subtree root and sets shrunk if the subtree lost a level.
+*/
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::rebalanceRight(uint32_t n, bool& shrunk)
+{
+    uint32_t c = nodes_[n].right;
+    int cb = getBalance(c);
+    if(cb >= 0) {
+        rotateLeft(n);
+        setBalance(n, cb == 0 ? 1 : 0);
+        setBalance(c, cb == 0 ? -1 : 0);
+        shrunk = (cb != 0);
+        return c;
+    }
+    uint32_t g = nodes_[c].left;
+    int gb = getBalance(g);
+    rotateRight(c);
+    rotateLeft(n);
+    setBalance(n, gb == 1 ? -1 : 0);
+    setBalance(c, gb == -1 ? 1 : 0);
+    setBalance(g, 0);
+    shrunk = true;
+    return g;
+}
+
+template<class Key, class Value>
+uint32_t CompactAVLTree<Key, Value>::rebalanceLeft(uint32_t n, bool& shrunk)
+{
+    uint32_t c = nodes_[n].left;
+    int cb = getBalance(c);
+    if(cb <= 0) {
+        rotateRight(n);
+        setBalance(n, cb == 0 ? -1 : 0);
+        setBalance(c, cb == 0 ? 1 : 0);
+        shrunk = (cb != 0);
+        return c;
+    }
+    uint32_t g = nodes_[c].right;
+    int gb = getBalance(g);
+    rotateLeft(c);
+    rotateRight(n);
+    setBalance(n, gb == -1 ? 1 : 0);
+    setBalance(c, gb == 1 ? -1 : 0);
+    setBalance(g, 0);
+    shrunk = true;
+    return g;
+}
+
+/**
+* Inserts the pair, or overwrites the value if the key is present. The
+* new node is appended to the vector, so inserting never moves nodes
+* but may reallocate the storage.
+*/
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    uint32_t parent = COMPACT_NIL;
+    uint32_t curr = root_;
+    bool left = false;
+    while(curr != COMPACT_NIL) {
+        CompactNode& n = nodes_[curr];
+        if(keyValuePair.first == n.item.first) {
+            n.item.second = keyValuePair.second;
+            return;
+        }
+        parent = curr;
+        left = keyValuePair.first < n.item.first;
+        curr = left ? n.left : n.right;
+    }
+    if(nodes_.size() >= COMPACT_NIL) {
+        throw std::length_error("CompactAVLTree is full");
+    }
+
+    uint32_t added = (uint32_t)nodes_.size();
+    nodes_.push_back(CompactNode(keyValuePair.first, keyValuePair.second, parent));
+    if(parent == COMPACT_NIL) {
+        root_ = added;
+        return;
+    }
+    if(left) {
+        nodes_[parent].left = added;
+    }
+    else {
+        nodes_[parent].right = added;
+    }
+    insertFix(added);
+}
+
+/**
+* Walks up from a newly grown subtree n until the growth is absorbed
+* or fixed by a rotation.
+*/
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::insertFix(uint32_t n)
+{
+    uint32_t p = getParent(n);
+    while(p != COMPACT_NIL) {
+        int b = getBalance(p) + ((n == nodes_[p].left) ? -1 : 1);
+        if(b == 0) {
+            setBalance(p, 0);
+            return;
+        }
+        if(b == 2 || b == -2) {
+            bool shrunk;
+            if(b == 2) rebalanceRight(p, shrunk);
+            else rebalanceLeft(p, shrunk);
+            return;
+        }
+        setBalance(p, b);
+        n = p;
+        p = getParent(p);
+    }
+}
+
+/**
+* Removes the key if present. For a node with two children the
+* predecessor's item is copied into it and the predecessor's node is
+* unlinked instead. The freed slot is then filled by moving the last
+* node of the vector into it (see relocate()), so any node may change
+* index and iterators are invalidated.
+*/
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::remove(const Key& key)
+{
+    uint32_t n = internalFind(key);
+    if(n == COMPACT_NIL) {
+        return;
+    }
+    if(nodes_[n].left != COMPACT_NIL && nodes_[n].right != COMPACT_NIL) {
+        // copy the predecessor's item into n and remove the predecessor instead
+        uint32_t pred = nodes_[n].left;
+        while(nodes_[pred].right != COMPACT_NIL) {
+            pred = nodes_[pred].right;
+        }
+        nodes_[n].item.~pair();
+        new (&nodes_[n].item) std::pair<const Key, Value>(nodes_[pred].item);
+        n = pred;
+    }
+
+    uint32_t child = (nodes_[n].left != COMPACT_NIL) ? nodes_[n].left : nodes_[n].right;
+    uint32_t p = getParent(n);
+    bool wasLeft = (p != COMPACT_NIL && nodes_[p].left == n);
+    replaceChild(p, n, child);
+    if(p != COMPACT_NIL) {
+        removeFix(p, wasLeft);
+    }
+    relocate((uint32_t)nodes_.size() - 1, n);
+}
+
+/**
+* Walks up from p, whose left (or right) subtree just lost a level,
+* until the height change is absorbed.
+*/
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::removeFix(uint32_t p, bool leftShrunk)
+{
+    while(p != COMPACT_NIL) {
+        int b = getBalance(p) + (leftShrunk ? 1 : -1);
+        uint32_t top = p;
+        if(b == 1 || b == -1) {
+            setBalance(p, b);
+            return;
+        }
+        if(b == 0) {
+            setBalance(p, 0);
+        }
+        else {
+            bool shrunk;
+            top = (b == 2) ? rebalanceRight(p, shrunk) : rebalanceLeft(p, shrunk);
+            if(!shrunk) {
+                return;
+            }
+        }
+        p = getParent(top);
+        if(p != COMPACT_NIL) {
+            leftShrunk = (nodes_[p].left == top);
+        }
+    }
+}
+
+/**
+* Moves the node at from into the (already unlinked) slot to and drops
+* the last slot, keeping the node vector dense.
+*/
+template<class Key, class Value>
+void CompactAVLTree<Key, Value>::relocate(uint32_t from, uint32_t to)
+{
+    if(from != to) {
+        CompactNode& moved = nodes_[from];
+        replaceChild(getParent(from), from, to);
+        if(moved.left != COMPACT_NIL) setParent(moved.left, to);
+        if(moved.right != COMPACT_NIL) setParent(moved.right, to);
+        nodes_[to].~CompactNode();
+        new (&nodes_[to]) CompactNode(moved);
+    }
+    nodes_.pop_back();
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the CompactAVLTree class.
+  -----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,309 @@
+#ifndef INTERVAL_AVLBST_H
+#define INTERVAL_AVLBST_H
+
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "augmented_avlbst.h"
+
+/**
+* A closed interval [start, end], the key of an IntervalTree. Intervals
+* are ordered by start, then by end.
+*/
+template<typename Point>
+struct Interval
+{
+    Interval() : start(), end() { }
+    Interval(const Point& s, const Point& e) : start(s), end(e) { }
+
+    bool overlaps(const Point& lo, const Point& hi) const { return !(hi < start) && !(end < lo); }
+
+    Point start;
+    Point end;
+};
+
+template<typename Point>
+bool operator<(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return (a.start < b.start) || (!(b.start < a.start) && a.end < b.end);
+}
+
+template<typename Point>
+bool operator>(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return b < a;
+}
+
+template<typename Point>
+bool operator==(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return !(a < b) && !(b < a);
+}
+
+template<typename Point>
+bool operator!=(const Interval<Point>& a, const Interval<Point>& b)
+{
+    return !(a == b);
+}
+
+template<typename Point>
+std::ostream& operator<<(std::ostream& os, const Interval<Point>& interval)
+{
+    return os << '[' << interval.start << ", " << interval.end << ']';
+}
+
+/**
+* The summary an IntervalTree keeps in each node: the largest end point
+* in the subtree.
+*/
+template<typename Point>
+struct MaxEndMonoid
+{
+    static_assert(std::numeric_limits<Point>::is_specialized,
+                  "MaxEndMonoid takes its identity from std::numeric_limits<Point>::lowest()");
+
+    typedef Point Summary;
+    Summary identity() const { return std::numeric_limits<Point>::lowest(); }
+    template<class Value>
+    Summary measure(const Interval<Point>& key, const Value& value) const { return key.end; }
+    Summary combine(const Summary& left, const Summary& right) const { return (left < right) ? right : left; }
+};
+
+/**
+* An AVLTree keyed by closed intervals [start, end], ordered by start,
+* with the maximum end of each subtree kept up to date through
+* inserts, removals and rotations by AugmentedAVLTree.
+*
+* A subtree whose maximum end is below the query, and a right subtree
+* whose starts are all above it, are skipped, so reporting the k
+* intervals that overlap a query costs O(min(n, (k+1) log n)): a
+* subtree that reaches the query may still hold only one overlap, deep
+* down, and even with no overlap the walk descends one path.
+* findAnyOverlapping() finds one in O(log n). Intervals with the same
+* start and end share one entry, like equal keys in any other tree.
+*
+* Every path that adds a key (insert(), upsert(), getOrInsert(),
+* insert_batch() and bulkLoad()) rejects an interval that ends before
+* it starts.
+*/
+template <typename Point, typename Value>
+class IntervalTree : public AugmentedAVLTree<Interval<Point>, Value, MaxEndMonoid<Point> >
+{
+public:
+    typedef AugmentedAVLTree<Interval<Point>, Value, MaxEndMonoid<Point> > Base;
+    typedef typename Base::iterator iterator;
+
+    virtual void insert(const std::pair<const Interval<Point>, Value>& keyValuePair);
+    void insert(const Point& start, const Point& end, const Value& value);
+    template<class Combine>
+    void upsert(const Interval<Point>& key, const Value& value, Combine combine);
+    Value& getOrInsert(const Interval<Point>& key);
+    template<class ForwardIterator>
+    void insert_batch(ForwardIterator first, ForwardIterator last);
+    template<class InputIterator>
+    void bulkLoad(InputIterator first, InputIterator last);
+
+    std::vector<iterator> findOverlapping(const Point& lo, const Point& hi) const;
+    std::vector<iterator> findContaining(const Point& point) const;
+    iterator findAnyOverlapping(const Point& lo, const Point& hi) const;
+    template<class Visit>
+    void forEachOverlapping(const Point& lo, const Point& hi, Visit visit) const;
+
+protected:
+    static void checkInterval(const Interval<Point>& interval);
+    template<class Visit>
+    void visitOverlapping(Node<Interval<Point>, Value>* n, const Point& lo, const Point& hi, Visit& visit) const;
+    virtual size_t treeBytes() const;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the IntervalTree class.
+  -------------------------------------------------
+*/
+
+/**
+* Throws std::invalid_argument if the interval ends before it starts.
+*/
+template<class Point, class Value>
+void IntervalTree<Point, Value>::insert(const std::pair<const Interval<Point>, Value>& keyValuePair)
+{
+    checkInterval(keyValuePair.first);
+    Base::insert(keyValuePair);
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::insert(const Point& start, const Point& end, const Value& value)
+{
+    insert(std::pair<const Interval<Point>, Value>(Interval<Point>(start, end), value));
+}
+
+template<class Point, class Value>
+template<class Combine>
+void IntervalTree<Point, Value>::upsert(const Interval<Point>& key, const Value& value, Combine combine)
+{
+    checkInterval(key);
+    Base::upsert(key, value, combine);
+}
+
+template<class Point, class Value>
+Value& IntervalTree<Point, Value>::getOrInsert(const Interval<Point>& key)
+{
+    checkInterval(key);
+    return Base::getOrInsert(key);
+}
+
+/**
+* Checks the whole run before inserting any of it, so a bad interval
+* leaves the tree as it was.
+*/
+template<class Point, class Value>
+template<class ForwardIterator>
+void IntervalTree<Point, Value>::insert_batch(ForwardIterator first, ForwardIterator last)
+{
+    for (ForwardIterator it = first; it != last; ++it) {
+        checkInterval(it -> first);
+    }
+    Base::insert_batch(first, last);
+}
+
+/**
+* Adds a range of (interval, value) pairs in any order. They are sorted
+* and handed to insert_batch(), which links an empty tree straight from
+* the sorted run in O(m) with every subtree's maximum end filled in on
+* the way up. A repeated interval keeps the value that came last.
+*
+* Throws std::invalid_argument, before inserting anything, if an
+* interval ends before it starts.
+*/
+template<class Point, class Value>
+template<class InputIterator>
+void IntervalTree<Point, Value>::bulkLoad(InputIterator first, InputIterator last)
+{
+    std::vector<std::pair<Interval<Point>, Value> > items;
+    for (; first != last; ++first) {
+        checkInterval(first -> first);
+        items.push_back(std::pair<Interval<Point>, Value>(first -> first, first -> second));
+    }
+    std::stable_sort(items.begin(), items.end(),
+        [](const std::pair<Interval<Point>, Value>& a, const std::pair<Interval<Point>, Value>& b) {
+            return a.first < b.first;
+        });
+    Base::insert_batch(items.begin(), items.end());
+}
+
+/**
+* Returns iterators to the intervals that share a point with [lo, hi],
+* in key order.
+*/
+template<class Point, class Value>
+std::vector<typename IntervalTree<Point, Value>::iterator>
+IntervalTree<Point, Value>::findOverlapping(const Point& lo, const Point& hi) const
+{
+    std::vector<iterator> found;
+    auto collect = [&found](Node<Interval<Point>, Value>* n) { found.push_back(Base::makeIterator(n)); };
+    visitOverlapping(this -> root_, lo, hi, collect);
+    return found;
+}
+
+/**
+* Stabbing query: the intervals that contain point.
+*/
+template<class Point, class Value>
+std::vector<typename IntervalTree<Point, Value>::iterator>
+IntervalTree<Point, Value>::findContaining(const Point& point) const
+{
+    return findOverlapping(point, point);
+}
+
+/**
+* Returns an iterator to some interval that overlaps [lo, hi], or end(),
+* in O(log n). Going left whenever the left subtree reaches lo is safe:
+* if nothing there overlaps, the interval that reaches lo starts after
+* hi, and so does everything to its right.
+*/
+template<class Point, class Value>
+typename IntervalTree<Point, Value>::iterator
+IntervalTree<Point, Value>::findAnyOverlapping(const Point& lo, const Point& hi) const
+{
+    Node<Interval<Point>, Value>* n = this -> root_;
+    while (n != NULL) {
+        BST_COUNT(comparisons);
+        if (!n -> isDead() && n -> getKey().overlaps(lo, hi)) {
+            return Base::makeIterator(n);
+        }
+        if (n -> getLeft() != NULL && !(this -> summaryOf(n -> getLeft()) < lo)) {
+            n = n -> getLeft();
+        }
+        else if (hi < n -> getKey().start) {
+            break;
+        }
+        else {
+            n = n -> getRight();
+        }
+    }
+    return this -> end();
+}
+
+/**
+* Calls visit(item) for each (interval, value) pair that overlaps
+* [lo, hi], in key order, without building a result vector.
+*/
+template<class Point, class Value>
+template<class Visit>
+void IntervalTree<Point, Value>::forEachOverlapping(const Point& lo, const Point& hi, Visit visit) const
+{
+    auto call = [&visit](Node<Interval<Point>, Value>* n) { visit(n -> getItem()); };
+    visitOverlapping(this -> root_, lo, hi, call);
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::checkInterval(const Interval<Point>& interval)
+{
+    if (interval.end < interval.start) {
+        throw std::invalid_argument("IntervalTree: interval ends before it starts");
+    }
+}
+
+/**
+* In-order walk that skips subtrees ending before lo and stops going
+* right at the first start after hi. Every node it enters either
+* overlaps or lies on the path to one that does, or on the single
+* path that finds there is none, so k results cost
+* O(min(n, (k+1) log n)). Recurses on the left child and loops down the
+* right, so the stack is bounded by the tree height.
+*/
+template<class Point, class Value>
+template<class Visit>
+void IntervalTree<Point, Value>::visitOverlapping(Node<Interval<Point>, Value>* n, const Point& lo, const Point& hi, Visit& visit) const
+{
+    while (n != NULL && !(this -> summaryOf(n) < lo)) {
+        BST_COUNT(comparisons);
+        visitOverlapping(n -> getLeft(), lo, hi, visit);
+        if (hi < n -> getKey().start) {
+            return;
+        }
+        if (!n -> isDead() && !(n -> getKey().end < lo)) {
+            visit(n);
+        }
+        n = n -> getRight();
+    }
+}
+
+template<class Point, class Value>
+size_t IntervalTree<Point, Value>::treeBytes() const
+{
+    return sizeof(*this);
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the IntervalTree class.
+  -------------------------------------------------
+*/
+
+#endif
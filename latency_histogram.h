@@ -0,0 +1,200 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Each power-of-two range of latencies is split into this many equal
+// sub-buckets, so a reported percentile is within 1/16 (about 6%) of
+// the true value. Values below the first range get one bucket each.
+#define LATENCY_SUB_BUCKET_BITS 4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+/**
+* A log-bucketed (HDR-style) histogram of latencies in nanoseconds.
+*
+* record() only does relaxed atomic increments, so any number of threads
+* can record into the same histogram without locking. Readers see counts
+* that may be a few samples behind concurrent writers.
+*
+* A tree shares one histogram per operation between all threads rather
+* than keeping one per thread. Only concurrent find()s can record at the
+* same time (a tree's writers are serialized by the caller), and
+* per-thread copies would multiply the 8 KB of buckets per histogram by
+* the thread count and make every read sum them up.
+*/
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds);
+    void reset();
+
+    uint64_t count() const;
+    uint64_t max() const;
+    uint64_t percentile(double percent) const;
+    uint64_t p50() const { return percentile(50.0); }
+    uint64_t p99() const { return percentile(99.0); }
+    uint64_t p999() const { return percentile(99.9); }
+
+protected:
+    static unsigned int bucketOf(uint64_t value);
+    static uint64_t highestInBucket(unsigned int bucket);
+
+    std::atomic<uint64_t> buckets_[LATENCY_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> max_;
+};
+
+/**
+* Per-operation latency histograms kept by a tree once
+* BinarySearchTree::enableLatency() has been called.
+*/
+struct BSTLatency
+{
+    LatencyHistogram insert;
+    LatencyHistogram remove;
+    LatencyHistogram find;
+
+    void reset()
+    {
+        insert.reset();
+        remove.reset();
+        find.reset();
+    }
+};
+
+/**
+* Times the enclosing scope into a histogram. A NULL histogram makes it
+* a no-op that never reads the clock.
+*/
+class LatencyTimer
+{
+public:
+    explicit LatencyTimer(LatencyHistogram* histogram);
+    ~LatencyTimer();
+
+private:
+    LatencyHistogram* histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/*
+----------------------------------------------------
+Begin implementations for the LatencyHistogram class.
+----------------------------------------------------
+*/
+
+inline LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+inline void LatencyHistogram::record(uint64_t nanoseconds)
+{
+    buckets_[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while(nanoseconds > seen && !max_.compare_exchange_weak(seen, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+inline void LatencyHistogram::reset()
+{
+    for(unsigned int i = 0; i < LATENCY_BUCKETS; ++i) {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+inline uint64_t LatencyHistogram::count() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+inline uint64_t LatencyHistogram::max() const
+{
+    return max_.load(std::memory_order_relaxed);
+}
+
+/**
+* Returns the smallest recorded latency that at least percent% of the
+* samples do not exceed, rounded up to the top of its bucket (but never
+* above max()). Returns 0 for an empty histogram.
+*/
+inline uint64_t LatencyHistogram::percentile(double percent) const
+{
+    uint64_t total = count();
+    if(total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(percent / 100.0 * total + 0.5);
+    if(rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for(unsigned int i = 0; i < LATENCY_BUCKETS; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if(seen >= rank) {
+            uint64_t top = highestInBucket(i);
+            return (top < max()) ? top : max();
+        }
+    }
+    return max();
+}
+
+/**
+* Values below LATENCY_SUB_BUCKETS get a bucket each; above that, the
+* highest set bit picks the power-of-two range and the next
+* LATENCY_SUB_BUCKET_BITS bits pick the sub-bucket within it.
+*/
+inline unsigned int LatencyHistogram::bucketOf(uint64_t value)
+{
+    if(value < LATENCY_SUB_BUCKETS) {
+        return (unsigned int)value;
+    }
+    unsigned int msb = 63 - __builtin_clzll(value);
+    unsigned int shift = msb - LATENCY_SUB_BUCKET_BITS;
+    unsigned int sub = (unsigned int)(value >> shift) & (LATENCY_SUB_BUCKETS - 1);
+    return (shift + 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+inline uint64_t LatencyHistogram::highestInBucket(unsigned int bucket)
+{
+    if(bucket < LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    uint64_t sub = bucket % LATENCY_SUB_BUCKETS;
+    uint64_t low = (uint64_t)(LATENCY_SUB_BUCKETS + sub) << shift;
+    return low + ((uint64_t)1 << shift) - 1;
+}
+
+/*
+--------------------------------------------------
+End implementations for the LatencyHistogram class.
+--------------------------------------------------
+*/
+
+inline LatencyTimer::LatencyTimer(LatencyHistogram* histogram) :
+    histogram_(histogram)
+{
+    if(histogram_ != NULL) {
+        start_ = std::chrono::steady_clock::now();
+    }
+}
+
+inline LatencyTimer::~LatencyTimer()
+{
+    if(histogram_ != NULL) {
+        histogram_->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+    }
+}
+
+#endif
@@ -0,0 +1,456 @@
+#ifndef MAPPED_BST_H
+#define MAPPED_BST_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bst.h"
+
+// Relocatable tree image
+// Version 1
+//
+//   header: MappedTreeHeader, padded to MAPPED_TREE_NODES_OFFSET bytes
+//   nodes:  count x MappedNode, stored in key order
+//
+// Children are linked by 32-bit node indices instead of pointers, so the
+// file can be mapped at any address and queried without being loaded.
+// Keys and values are stored as raw bytes and must be trivially copyable.
+
+#define MAPPED_TREE_VERSION 1
+#define MAPPED_TREE_NODES_OFFSET 64
+#define MAPPED_TREE_NIL 0xFFFFFFFFu
+
+struct MappedTreeHeader
+{
+    char magic[4];          // "BSTI"
+    uint32_t version;
+    uint32_t keySize;
+    uint32_t valueSize;
+    uint32_t nodeSize;
+    uint32_t root;          // index of the root node or MAPPED_TREE_NIL
+    uint64_t count;
+};
+
+/**
+* A node inside a tree image. first/second mirror std::pair so that
+* iterator code written for BinarySearchTree reads the same.
+*/
+template <typename Key, typename Value>
+struct MappedNode
+{
+    Key first;
+    Value second;
+    uint32_t left;
+    uint32_t right;
+};
+
+/**
+* Writes a tree image of the given tree. The image is laid out in key
+* order and linked as a perfectly balanced tree, so it is usually
+* shallower than the live tree it came from.
+*/
+template <typename Key, typename Value>
+class MappedTreeWriter
+{
+public:
+    static void write(const BinarySearchTree<Key, Value>& tree, const std::string& path);
+
+private:
+    MappedTreeWriter(const BinarySearchTree<Key, Value>& tree, std::ofstream& out);
+    uint32_t emit(uint64_t lo, uint64_t hi);
+    static uint32_t middle(uint64_t lo, uint64_t hi);
+    void flush();
+
+    typename BinarySearchTree<Key, Value>::iterator it_;
+    std::ofstream& out_;
+    std::vector<MappedNode<Key, Value> > buffer_;
+};
+
+/**
+* A read-only view of a tree image. Opening it maps the file and checks
+* the header; pages are only touched as queries reach them. The node
+* links are only checked as queries follow them, and a link outside the
+* image makes the query throw std::runtime_error.
+*/
+template <typename Key, typename Value>
+class MappedTree
+{
+public:
+    explicit MappedTree(const std::string& path);
+    ~MappedTree();
+
+    class iterator
+    {
+    public:
+        iterator();
+
+        const MappedNode<Key, Value>& operator*() const;
+        const MappedNode<Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class MappedTree<Key, Value>;
+        iterator(const MappedNode<Key, Value>* ptr);
+        const MappedNode<Key, Value>* current_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    uint64_t size() const;
+    bool empty() const;
+
+private:
+    const MappedNode<Key, Value>& nodeAt(uint32_t index, uint64_t depth) const;
+
+    // the mapping is owned, so views are not copyable
+    MappedTree(const MappedTree&);
+    MappedTree& operator=(const MappedTree&);
+
+    void* map_;
+    size_t mapLength_;
+    const MappedNode<Key, Value>* nodes_;
+    uint64_t count_;
+    uint32_t root_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the MappedTreeWriter class.
+  -----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+void MappedTreeWriter<Key, Value>::write(const BinarySearchTree<Key, Value>& tree, const std::string& path)
+{
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "tree images store keys and values as raw bytes");
+
+    uint64_t count = 0;
+    for(typename BinarySearchTree<Key, Value>::iterator it = tree.begin(); it != tree.end(); ++it)
+    {
+        ++count;
+    }
+    if(count >= MAPPED_TREE_NIL)
+    {
+        throw std::length_error("Too many nodes for a 32-bit tree image");
+    }
+
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if(!out)
+    {
+        throw std::runtime_error("Unable to open " + path + " for writing");
+    }
+
+    MappedTreeHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "BSTI", 4);
+    header.version = MAPPED_TREE_VERSION;
+    header.keySize = sizeof(Key);
+    header.valueSize = sizeof(Value);
+    header.nodeSize = sizeof(MappedNode<Key, Value>);
+    header.root = (count == 0) ? MAPPED_TREE_NIL : middle(0, count);
+    header.count = count;
+    char padded[MAPPED_TREE_NODES_OFFSET];
+    std::memset(padded, 0, sizeof(padded));
+    std::memcpy(padded, &header, sizeof(header));
+    out.write(padded, sizeof(padded));
+
+    MappedTreeWriter<Key, Value> writer(tree, out);
+    writer.emit(0, count);
+    writer.flush();
+
+    out.close();
+    if(!out)
+    {
+        throw std::runtime_error("Failed writing tree image " + path);
+    }
+}
+
+template<typename Key, typename Value>
+MappedTreeWriter<Key, Value>::MappedTreeWriter(const BinarySearchTree<Key, Value>& tree, std::ofstream& out) :
+    it_(tree.begin()),
+    out_(out)
+{
+    buffer_.reserve(65536);
+}
+
+/**
+* Index of the root of the balanced subtree covering nodes [lo, hi).
+*/
+template<typename Key, typename Value>
+uint32_t MappedTreeWriter<Key, Value>::middle(uint64_t lo, uint64_t hi)
+{
+    return (uint32_t)(lo + (hi - lo) / 2);
+}
+
+/**
+* Writes nodes [lo, hi) in key order, pairing each with the next tree
+* item, and returns the index of the subtree root.
+*/
+template<typename Key, typename Value>
+uint32_t MappedTreeWriter<Key, Value>::emit(uint64_t lo, uint64_t hi)
+{
+    if(lo >= hi)
+    {
+        return MAPPED_TREE_NIL;
+    }
+    uint32_t mid = middle(lo, hi);
+
+    MappedNode<Key, Value> node;
+    std::memset(&node, 0, sizeof(node));
+    node.left = emit(lo, mid);
+    node.right = (mid + 1 < hi) ? middle(mid + 1, hi) : MAPPED_TREE_NIL;
+    node.first = it_->first;
+    node.second = it_->second;
+    ++it_;
+    buffer_.push_back(node);
+    if(buffer_.size() == buffer_.capacity())
+    {
+        flush();
+    }
+
+    emit(mid + 1, hi);
+    return mid;
+}
+
+template<typename Key, typename Value>
+void MappedTreeWriter<Key, Value>::flush()
+{
+    if(!buffer_.empty())
+    {
+        out_.write(reinterpret_cast<const char*>(&buffer_[0]), buffer_.size() * sizeof(MappedNode<Key, Value>));
+        buffer_.clear();
+    }
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the MappedTreeWriter class.
+  -----------------------------------------------
+*/
+
+/*
+  -----------------------------------------------
+  Begin implementations for the MappedTree::iterator class.
+  -----------------------------------------------
+*/
+
+template<typename Key, typename Value>
+MappedTree<Key, Value>::iterator::iterator() :
+    current_(NULL)
+{
+
+}
+
+template<typename Key, typename Value>
+MappedTree<Key, Value>::iterator::iterator(const MappedNode<Key, Value>* ptr) :
+    current_(ptr)
+{
+
+}
+
+template<typename Key, typename Value>
+const MappedNode<Key, Value>& MappedTree<Key, Value>::iterator::operator*() const
+{
+    return *current_;
+}
+
+template<typename Key, typename Value>
+const MappedNode<Key, Value>* MappedTree<Key, Value>::iterator::operator->() const
+{
+    return current_;
+}
+
+template<typename Key, typename Value>
+bool MappedTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<typename Key, typename Value>
+bool MappedTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* Nodes are stored in key order, so the successor is the next node.
+*/
+template<typename Key, typename Value>
+typename MappedTree<Key, Value>::iterator& MappedTree<Key, Value>::iterator::operator++()
+{
+    ++current_;
+    return *this;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the MappedTree::iterator class.
+  -----------------------------------------------
+*/
+
+/*
+  -----------------------------------------------
+  Begin implementations for the MappedTree class.
+  -----------------------------------------------
+*/
+
+/**
+* Maps the image read-only and validates its header. Runs in O(1).
+*/
+template<typename Key, typename Value>
+MappedTree<Key, Value>::MappedTree(const std::string& path) :
+    map_(MAP_FAILED),
+    mapLength_(0),
+    nodes_(NULL),
+    count_(0),
+    root_(MAPPED_TREE_NIL)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        throw std::runtime_error("Unable to open " + path);
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size < MAPPED_TREE_NODES_OFFSET)
+    {
+        close(fd);
+        throw std::runtime_error(path + " is not a tree image");
+    }
+    mapLength_ = info.st_size;
+    map_ = mmap(NULL, mapLength_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map_ == MAP_FAILED)
+    {
+        throw std::runtime_error("Unable to map " + path);
+    }
+
+    MappedTreeHeader header;
+    std::memcpy(&header, map_, sizeof(header));
+    // compare counts rather than byte sizes, which a huge count overflows
+    uint64_t fits = (mapLength_ - MAPPED_TREE_NODES_OFFSET) / sizeof(MappedNode<Key, Value>);
+    if(std::memcmp(header.magic, "BSTI", 4) != 0 || header.version != MAPPED_TREE_VERSION ||
+       header.keySize != sizeof(Key) || header.valueSize != sizeof(Value) ||
+       header.nodeSize != sizeof(MappedNode<Key, Value>) ||
+       header.count >= MAPPED_TREE_NIL || header.count > fits ||
+       (header.count == 0 && header.root != MAPPED_TREE_NIL) ||
+       (header.count != 0 && header.root >= header.count))
+    {
+        munmap(map_, mapLength_);
+        throw std::runtime_error(path + " is not a tree image for these key/value types");
+    }
+    nodes_ = reinterpret_cast<const MappedNode<Key, Value>*>(static_cast<const char*>(map_) + MAPPED_TREE_NODES_OFFSET);
+    count_ = header.count;
+    root_ = header.root;
+}
+
+template<typename Key, typename Value>
+MappedTree<Key, Value>::~MappedTree()
+{
+    munmap(map_, mapLength_);
+}
+
+template<typename Key, typename Value>
+typename MappedTree<Key, Value>::iterator MappedTree<Key, Value>::begin() const
+{
+    return iterator(nodes_);
+}
+
+template<typename Key, typename Value>
+typename MappedTree<Key, Value>::iterator MappedTree<Key, Value>::end() const
+{
+    return iterator(nodes_ + count_);
+}
+
+/**
+* Returns an iterator to the node with the given key, or end().
+*/
+template<typename Key, typename Value>
+typename MappedTree<Key, Value>::iterator MappedTree<Key, Value>::find(const Key& key) const
+{
+    uint32_t curr = root_;
+    for(uint64_t depth = 0; curr != MAPPED_TREE_NIL; ++depth)
+    {
+        const MappedNode<Key, Value>& node = nodeAt(curr, depth);
+        if(key == node.first)
+        {
+            return iterator(&node);
+        }
+        curr = (key < node.first) ? node.left : node.right;
+    }
+    return end();
+}
+
+/**
+* Returns an iterator to the first node whose key is not less than key.
+*/
+template<typename Key, typename Value>
+typename MappedTree<Key, Value>::iterator MappedTree<Key, Value>::lower_bound(const Key& key) const
+{
+    const MappedNode<Key, Value>* best = nodes_ + count_;
+    uint32_t curr = root_;
+    for(uint64_t depth = 0; curr != MAPPED_TREE_NIL; ++depth)
+    {
+        const MappedNode<Key, Value>& node = nodeAt(curr, depth);
+        if(node.first < key)
+        {
+            curr = node.right;
+        }
+        else
+        {
+            best = &node;
+            curr = node.left;
+        }
+    }
+    return iterator(best);
+}
+
+/**
+* The node a descent reached at the given depth. A path longer than the
+* node count must have gone round a cycle, so both that and an index
+* past the last node mean the image is corrupt.
+*/
+template<typename Key, typename Value>
+const MappedNode<Key, Value>& MappedTree<Key, Value>::nodeAt(uint32_t index, uint64_t depth) const
+{
+    if(index >= count_ || depth >= count_)
+    {
+        throw std::runtime_error("Corrupt tree image: node link out of range");
+    }
+    return nodes_[index];
+}
+
+template<typename Key, typename Value>
+uint64_t MappedTree<Key, Value>::size() const
+{
+    return count_;
+}
+
+template<typename Key, typename Value>
+bool MappedTree<Key, Value>::empty() const
+{
+    return count_ == 0;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the MappedTree class.
+  -----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef NODE_INDEX_H
+#define NODE_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+template <typename Key, typename Value>
+class Node;
+
+// An index grows to twice its slots once more than this share of them
+// would be in use, which keeps linear probe runs short.
+#define NODE_INDEX_MAX_LOAD 0.5
+#define NODE_INDEX_MIN_SLOTS 16
+
+/**
+* Key to node lookup that a tree keeps beside itself (see
+* BinarySearchTree::enableHashIndex()). The tree only sees this
+* interface, so the hash is only required of keys that are indexed.
+*/
+template <typename Key, typename Value>
+class NodeIndexBase
+{
+public:
+    virtual ~NodeIndexBase() { }
+
+    virtual Node<Key, Value>* find(const Key& key) const = 0;
+    virtual void insert(Node<Key, Value>* n) = 0;
+    virtual void erase(Node<Key, Value>* n) = 0;
+    virtual void clear() = 0;
+    virtual size_t size() const = 0;
+    virtual size_t bytes() const = 0;
+};
+
+/**
+* Open-addressing hash table of node pointers with linear probing. The
+* key is read through the node, so a slot is a single pointer. The hash
+* is spread with a multiplicative (Fibonacci) step, since std::hash of
+* an integer is the integer itself and the table is indexed by its top
+* bits. Removal shifts the rest of the probe run back instead of leaving
+* a marker, so lookups never walk past deleted slots.
+*/
+template <typename Key, typename Value, typename Hash = std::hash<Key> >
+class NodeIndex : public NodeIndexBase<Key, Value>
+{
+public:
+    explicit NodeIndex(const Hash& hash = Hash());
+
+    virtual Node<Key, Value>* find(const Key& key) const;
+    virtual void insert(Node<Key, Value>* n);
+    virtual void erase(Node<Key, Value>* n);
+    virtual void clear();
+    virtual size_t size() const;
+    virtual size_t bytes() const;
+
+protected:
+    size_t home(const Key& key) const;
+    void resize(size_t slots);
+
+    Hash hash_;
+    std::vector<Node<Key, Value>*> slots_;
+    size_t mask_;
+    int shift_;
+    size_t size_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the NodeIndex class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value, class Hash>
+NodeIndex<Key, Value, Hash>::NodeIndex(const Hash& hash) :
+    hash_(hash), mask_(0), shift_(64), size_(0)
+{
+
+}
+
+template<class Key, class Value, class Hash>
+Node<Key, Value>* NodeIndex<Key, Value, Hash>::find(const Key& key) const
+{
+    if (size_ == 0) {
+        return NULL;
+    }
+    for (size_t i = home(key); slots_[i] != NULL; i = (i + 1) & mask_) {
+        if (slots_[i] -> getKey() == key) {
+            return slots_[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+* Adds a node whose key is not in the index yet.
+*/
+template<class Key, class Value, class Hash>
+void NodeIndex<Key, Value, Hash>::insert(Node<Key, Value>* n)
+{
+    if (size_ + 1 > slots_.size() * NODE_INDEX_MAX_LOAD) {
+        resize(slots_.empty() ? NODE_INDEX_MIN_SLOTS : 2 * slots_.size());
+    }
+    size_t i = home(n -> getKey());
+    while (slots_[i] != NULL) {
+        i = (i + 1) & mask_;
+    }
+    slots_[i] = n;
+    ++size_;
+}
+
+/**
+* Removes n, which must still be a live allocation, and moves later
+* entries of its probe run back into the hole when their home slot
+* allows it.
+*/
+template<class Key, class Value, class Hash>
+void NodeIndex<Key, Value, Hash>::erase(Node<Key, Value>* n)
+{
+    if (size_ == 0) {
+        return;
+    }
+    size_t hole = home(n -> getKey());
+    while (slots_[hole] != n) {
+        if (slots_[hole] == NULL) {
+            return;
+        }
+        hole = (hole + 1) & mask_;
+    }
+    for (size_t j = (hole + 1) & mask_; slots_[j] != NULL; j = (j + 1) & mask_) {
+        // the entry at j may fill the hole unless its home lies
+        // cyclically in (hole, j]
+        size_t h = home(slots_[j] -> getKey());
+        if (((j - h) & mask_) >= ((j - hole) & mask_)) {
+            slots_[hole] = slots_[j];
+            hole = j;
+        }
+    }
+    slots_[hole] = NULL;
+    --size_;
+}
+
+template<class Key, class Value, class Hash>
+void NodeIndex<Key, Value, Hash>::clear()
+{
+    std::vector<Node<Key, Value>*>().swap(slots_);
+    mask_ = 0;
+    shift_ = 64;
+    size_ = 0;
+}
+
+template<class Key, class Value, class Hash>
+size_t NodeIndex<Key, Value, Hash>::size() const
+{
+    return size_;
+}
+
+template<class Key, class Value, class Hash>
+size_t NodeIndex<Key, Value, Hash>::bytes() const
+{
+    return sizeof(*this) + slots_.capacity() * sizeof(Node<Key, Value>*);
+}
+
+template<class Key, class Value, class Hash>
+size_t NodeIndex<Key, Value, Hash>::home(const Key& key) const
+{
+    return (size_t)(((uint64_t)hash_(key) * 0x9E3779B97F4A7C15ULL) >> shift_);
+}
+
+template<class Key, class Value, class Hash>
+void NodeIndex<Key, Value, Hash>::resize(size_t slots)
+{
+    std::vector<Node<Key, Value>*> old;
+    old.swap(slots_);
+    slots_.assign(slots, NULL);
+    mask_ = slots - 1;
+    shift_ = 64;
+    for (size_t s = slots; s > 1; s >>= 1) {
+        --shift_;
+    }
+    size_ = 0;
+    for (size_t i = 0; i < old.size(); ++i) {
+        if (old[i] != NULL) {
+            insert(old[i]);
+        }
+    }
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the NodeIndex class.
+  -------------------------------------------------
+*/
+
+#endif
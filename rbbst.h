@@ -0,0 +1,490 @@
+#ifndef RBBST_H
+#define RBBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "bst.h"
+
+enum RBColor { RB_RED, RB_BLACK };
+
+/**
+* A node for a red-black tree, which adds the node's color to a plain Node.
+*/
+template <typename Key, typename Value>
+class RBNode : public Node<Key, Value>
+{
+public:
+    // Constructor/destructor.
+    RBNode(const Key& key, const Value& value, RBNode<Key, Value>* parent);
+    virtual ~RBNode();
+
+    // Getter/setter for the node's color.
+    RBColor getColor() const;
+    void setColor(RBColor color);
+
+    // Getters for parent, left, and right, returning RBNodes.
+    virtual RBNode<Key, Value>* getParent() const override;
+    virtual RBNode<Key, Value>* getLeft() const override;
+    virtual RBNode<Key, Value>* getRight() const override;
+
+protected:
+    RBColor color_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the RBNode class.
+  -------------------------------------------------
+*/
+
+/**
+* New nodes are red, as insert() expects.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::RBNode(const Key& key, const Value& value, RBNode<Key, Value> *parent) :
+    Node<Key, Value>(key, value, parent), color_(RB_RED)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::~RBNode()
+{
+
+}
+
+/**
+* A getter for the color of a RBNode.
+*/
+template<class Key, class Value>
+RBColor RBNode<Key, Value>::getColor() const
+{
+    return color_;
+}
+
+/**
+* A setter for the color of a RBNode.
+*/
+template<class Key, class Value>
+void RBNode<Key, Value>::setColor(RBColor color)
+{
+    color_ = color;
+}
+
+/**
+* An overridden function for getting the parent since a static_cast is necessary to make sure
+* that our node is a RBNode.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getParent() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->parent_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getLeft() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getRight() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RBNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A red-black tree. It is less strictly balanced than AVLTree, but
+* every insert or remove does at most three rotations; the rest of the
+* fix-up is recoloring.
+*/
+template <class Key, class Value>
+class RedBlackTree : public BinarySearchTree<Key, Value>
+{
+protected:
+    virtual Node<Key, Value>* findOrInsert(const Key& key, const Value& value, bool& inserted);
+    virtual void eraseNode(Node<Key, Value>* node);
+    static bool isRed(RBNode<Key, Value>* n);
+    virtual void nodeSwap(RBNode<Key, Value>* n1, RBNode<Key, Value>* n2);
+    void insertFix(RBNode<Key, Value>* n);
+    void removeFix(RBNode<Key, Value>* n, RBNode<Key, Value>* p);
+    void rotateLeft(RBNode<Key, Value>* node);
+    void rotateRight(RBNode<Key, Value>* node);
+    static int blackHeight(RBNode<Key, Value>* n);
+    virtual Node<Key, Value>* makeNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void setBuiltHeights(Node<Key, Value>* n, int leftHeight, int rightHeight);
+    virtual size_t nodeBytes() const;
+    virtual size_t balanceBytes() const;
+    virtual size_t treeBytes() const;
+    virtual bool rebalancesItself() const;
+};
+
+/*
+--------------------------------------------
+Begin implementations for the RedBlackTree class.
+--------------------------------------------
+*/
+
+/**
+* NULL children count as black.
+*/
+template<class Key, class Value>
+bool RedBlackTree<Key, Value>::isRed(RBNode<Key, Value>* n)
+{
+    return n != NULL && n->getColor() == RB_RED;
+}
+
+/**
+* Returns the node with the given key, or inserts a red node holding
+* value and restores the red-black properties.
+*/
+template<class Key, class Value>
+Node<Key, Value>* RedBlackTree<Key, Value>::findOrInsert(const Key& key, const Value& value, bool& inserted)
+{
+    RBNode<Key, Value>* parent = NULL;
+    RBNode<Key, Value>* curr = static_cast<RBNode<Key, Value>*>(this->root_);
+    while(curr != NULL) {
+        BST_COUNT(comparisons);
+        if(key == curr->getKey()) {
+            inserted = false;
+            return curr;
+        }
+        parent = curr;
+        curr = (key < curr->getKey()) ? curr->getLeft() : curr->getRight();
+    }
+
+    RBNode<Key, Value>* n = new RBNode<Key, Value>(key, value, parent);
+    BST_COUNT(allocations);
+    this->indexInsert(n);
+    if(parent == NULL) {
+        this->root_ = n;
+    }
+    else if(key < parent->getKey()) {
+        parent->setLeft(n);
+    }
+    else {
+        parent->setRight(n);
+    }
+    insertFix(n);
+    inserted = true;
+    return n;
+}
+
+/**
+* Restores the red-black properties after the red node n was added.
+* Recolors while n's uncle is red and finishes with at most two rotations.
+*/
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::insertFix(RBNode<Key, Value>* n)
+{
+    while(isRed(n->getParent())) {
+        RBNode<Key, Value>* p = n->getParent();
+        RBNode<Key, Value>* g = p->getParent();   // exists since the root is black
+        if(p == g->getLeft()) {
+            RBNode<Key, Value>* u = g->getRight();
+            if(isRed(u)) {
+                p->setColor(RB_BLACK);
+                u->setColor(RB_BLACK);
+                g->setColor(RB_RED);
+                n = g;
+                continue;
+            }
+            //zig-zag: rotate into the zig-zig case first
+            if(n == p->getRight()) {
+                BST_COUNT(doubleRotations);
+                rotateLeft(p);
+                std::swap(n, p);
+            }
+            else {
+                BST_COUNT(singleRotations);
+            }
+            rotateRight(g);
+        }
+        else {
+            RBNode<Key, Value>* u = g->getLeft();
+            if(isRed(u)) {
+                p->setColor(RB_BLACK);
+                u->setColor(RB_BLACK);
+                g->setColor(RB_RED);
+                n = g;
+                continue;
+            }
+            if(n == p->getLeft()) {
+                BST_COUNT(doubleRotations);
+                rotateRight(p);
+                std::swap(n, p);
+            }
+            else {
+                BST_COUNT(singleRotations);
+            }
+            rotateLeft(g);
+        }
+        p->setColor(RB_BLACK);
+        g->setColor(RB_RED);
+        break;
+    }
+    static_cast<RBNode<Key, Value>*>(this->root_)->setColor(RB_BLACK);
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::eraseNode(Node<Key, Value>* node)
+{
+    RBNode<Key, Value>* n = static_cast<RBNode<Key, Value>*>(node);
+    if(n->getLeft() != NULL && n->getRight() != NULL) {
+        nodeSwap(n, static_cast<RBNode<Key, Value>*>(BinarySearchTree<Key, Value>::predecessor(n)));
+    }
+
+    //n has at most one child now, promote it into n's place
+    RBNode<Key, Value>* p = n->getParent();
+    RBNode<Key, Value>* child = (n->getLeft() != NULL) ? n->getLeft() : n->getRight();
+    if(child != NULL) {
+        child->setParent(p);
+    }
+    if(p == NULL) {
+        this->root_ = child;
+    }
+    else if(n == p->getLeft()) {
+        p->setLeft(child);
+    }
+    else {
+        p->setRight(child);
+    }
+
+    if(n->getColor() == RB_BLACK) {
+        removeFix(child, p);
+    }
+    this->indexErase(n);
+    delete n;
+    BST_COUNT(frees);
+}
+
+/**
+* Restores the red-black properties after a black node was removed
+* from above n, the child of p that is now one black node short.
+* n may be NULL, so its parent is passed alongside it.
+*/
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::removeFix(RBNode<Key, Value>* n, RBNode<Key, Value>* p)
+{
+    while(n != this->root_ && !isRed(n)) {
+        if(n == p->getLeft()) {
+            RBNode<Key, Value>* s = p->getRight();
+            if(isRed(s)) {
+                BST_COUNT(singleRotations);
+                s->setColor(RB_BLACK);
+                p->setColor(RB_RED);
+                rotateLeft(p);
+                s = p->getRight();
+            }
+            if(!isRed(s->getLeft()) && !isRed(s->getRight())) {
+                s->setColor(RB_RED);
+                n = p;
+                p = n->getParent();
+                continue;
+            }
+            if(!isRed(s->getRight())) {
+                BST_COUNT(doubleRotations);
+                s->getLeft()->setColor(RB_BLACK);
+                s->setColor(RB_RED);
+                rotateRight(s);
+                s = p->getRight();
+            }
+            else {
+                BST_COUNT(singleRotations);
+            }
+            s->setColor(p->getColor());
+            p->setColor(RB_BLACK);
+            s->getRight()->setColor(RB_BLACK);
+            rotateLeft(p);
+        }
+        else {
+            RBNode<Key, Value>* s = p->getLeft();
+            if(isRed(s)) {
+                BST_COUNT(singleRotations);
+                s->setColor(RB_BLACK);
+                p->setColor(RB_RED);
+                rotateRight(p);
+                s = p->getLeft();
+            }
+            if(!isRed(s->getLeft()) && !isRed(s->getRight())) {
+                s->setColor(RB_RED);
+                n = p;
+                p = n->getParent();
+                continue;
+            }
+            if(!isRed(s->getLeft())) {
+                BST_COUNT(doubleRotations);
+                s->getRight()->setColor(RB_BLACK);
+                s->setColor(RB_RED);
+                rotateLeft(s);
+                s = p->getLeft();
+            }
+            else {
+                BST_COUNT(singleRotations);
+            }
+            s->setColor(p->getColor());
+            p->setColor(RB_BLACK);
+            s->getLeft()->setColor(RB_BLACK);
+            rotateRight(p);
+        }
+        n = static_cast<RBNode<Key, Value>*>(this->root_);
+    }
+    if(n != NULL) {
+        n->setColor(RB_BLACK);
+    }
+}
+
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::rotateLeft(RBNode<Key, Value>* node)
+{
+    RBNode<Key, Value>* c = node->getRight();
+    RBNode<Key, Value>* p = node->getParent();
+    node->setRight(c->getLeft());
+    if(c->getLeft() != NULL) {
+        c->getLeft()->setParent(node);
+    }
+    c->setLeft(node);
+    node->setParent(c);
+    c->setParent(p);
+    if(p == NULL) {
+        this->root_ = c;
+    }
+    else if(p->getLeft() == node) {
+        p->setLeft(c);
+    }
+    else {
+        p->setRight(c);
+    }
+}
+
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::rotateRight(RBNode<Key, Value>* node)
+{
+    RBNode<Key, Value>* c = node->getLeft();
+    RBNode<Key, Value>* p = node->getParent();
+    node->setLeft(c->getRight());
+    if(c->getRight() != NULL) {
+        c->getRight()->setParent(node);
+    }
+    c->setRight(node);
+    node->setParent(c);
+    c->setParent(p);
+    if(p == NULL) {
+        this->root_ = c;
+    }
+    else if(p->getLeft() == node) {
+        p->setLeft(c);
+    }
+    else {
+        p->setRight(c);
+    }
+}
+
+/**
+* Number of black nodes on the path down the left spine of n.
+*/
+template<class Key, class Value>
+int RedBlackTree<Key, Value>::blackHeight(RBNode<Key, Value>* n)
+{
+    int height = 0;
+    for(; n != NULL; n = n->getLeft()) {
+        if(n->getColor() == RB_BLACK) {
+            ++height;
+        }
+    }
+    return height;
+}
+
+/**
+* Bulk-built red-black trees are made of RBNodes.
+*/
+template<class Key, class Value>
+Node<Key, Value>* RedBlackTree<Key, Value>::makeNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    BST_COUNT(allocations);
+    return new RBNode<Key, Value>(key, value, static_cast<RBNode<Key, Value>*>(parent));
+}
+
+/**
+* Colors a bulk-built node once both of its subtrees are done. The build
+* keeps sibling sizes within one, so if the black heights differ the
+* deeper side is a perfect all-black subtree whose root can turn red.
+* The spine walks add up to O(n) over a balanced build.
+*/
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::setBuiltHeights(Node<Key, Value>* n, int leftHeight, int rightHeight)
+{
+    RBNode<Key, Value>* node = static_cast<RBNode<Key, Value>*>(n);
+    int leftBlack = blackHeight(node->getLeft());
+    int rightBlack = blackHeight(node->getRight());
+    if(leftBlack > rightBlack) {
+        node->getLeft()->setColor(RB_RED);
+    }
+    else if(rightBlack > leftBlack) {
+        node->getRight()->setColor(RB_RED);
+    }
+    node->setColor(RB_BLACK);
+}
+
+template<class Key, class Value>
+void RedBlackTree<Key, Value>::nodeSwap(RBNode<Key, Value>* n1, RBNode<Key, Value>* n2)
+{
+    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
+    RBColor tempC = n1->getColor();
+    n1->setColor(n2->getColor());
+    n2->setColor(tempC);
+}
+
+template<class Key, class Value>
+size_t RedBlackTree<Key, Value>::nodeBytes() const
+{
+    return sizeof(RBNode<Key, Value>);
+}
+
+template<class Key, class Value>
+size_t RedBlackTree<Key, Value>::balanceBytes() const
+{
+    return sizeof(RBColor);
+}
+
+template<class Key, class Value>
+size_t RedBlackTree<Key, Value>::treeBytes() const
+{
+    return sizeof(*this);
+}
+
+template<class Key, class Value>
+bool RedBlackTree<Key, Value>::rebalancesItself() const
+{
+    return true;
+}
+
+/*
+------------------------------------------
+End implementations for the RedBlackTree class.
+------------------------------------------
+*/
+
+#endif
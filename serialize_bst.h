@@ -0,0 +1,504 @@
+#ifndef SERIALIZE_BST_H
+#define SERIALIZE_BST_H
+
+#include <algorithm>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+
+// BST binary snapshot format
+// Version 1
+//
+//   header:  "BSTS" | version (u32) | flags (u32) | key size (u32) | value size (u32) | entry count (u64)
+//   body:    chunks of  entry count (u64) | byte length (u64) | entry bytes
+//   trailer: checksum of all entry bytes (u64)
+//
+// Entries are the in-order key/value stream. Integers are stored in the
+// byte order of the machine that wrote the file, which is checked through
+// the version field when loading.
+
+#define BSTS_VERSION 1
+#define BSTS_CHUNK_ENTRIES 65536
+
+// flags
+#define BSTS_RAW_KEYS 0x1
+#define BSTS_RAW_VALUES 0x2
+
+/**
+* User-provided serializer for keys or values that are not trivially
+* copyable. Specialize it with
+*
+*     static void write(std::ostream& out, const T& item);
+*     static T read(std::istream& in);
+*
+* Trivially copyable types are always written as raw bytes.
+*/
+template<typename T>
+struct BSTSerializer;
+
+/**
+* Serializer for strings: a u64 length followed by the characters.
+*/
+template<>
+struct BSTSerializer<std::string>
+{
+    static void write(std::ostream& out, const std::string& item)
+    {
+        uint64_t length = item.size();
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(item.data(), length);
+    }
+
+    static std::string read(std::istream& in)
+    {
+        uint64_t length = 0;
+        in.read(reinterpret_cast<char*>(&length), sizeof(length));
+        // snapshot chunks are read from memory, so a length past the
+        // end of the chunk means the data is corrupt
+        if(!in || length > (uint64_t)in.rdbuf()->in_avail())
+        {
+            in.setstate(std::ios::failbit);
+            return std::string();
+        }
+        std::string item(length, '\0');
+        if(length != 0) in.read(&item[0], length);
+        return item;
+    }
+};
+
+// Chooses between raw bytes and BSTSerializer for one field of an entry.
+template<typename T, bool Raw = std::is_trivially_copyable<T>::value>
+struct BSTSnapshotField
+{
+    static void write(std::ostream& out, const T& item)
+    {
+        out.write(reinterpret_cast<const char*>(&item), sizeof(T));
+    }
+
+    static void read(std::istream& in, T& item)
+    {
+        in.read(reinterpret_cast<char*>(&item), sizeof(T));
+    }
+};
+
+template<typename T>
+struct BSTSnapshotField<T, false>
+{
+    static void write(std::ostream& out, const T& item)
+    {
+        BSTSerializer<T>::write(out, item);
+    }
+
+    static void read(std::istream& in, T& item)
+    {
+        item = BSTSerializer<T>::read(in);
+    }
+};
+
+// Stream buffer over an in-memory chunk, so that serializers can use
+// plain std::ostream/std::istream without a stringstream copy.
+class BSTSChunkBuf : public std::streambuf
+{
+public:
+    explicit BSTSChunkBuf(std::string& chunk) : chunk_(chunk) { }
+
+    // start reading the current contents of the chunk
+    void rewind()
+    {
+        char* begin = chunk_.empty() ? NULL : &chunk_[0];
+        setg(begin, begin, begin + chunk_.size());
+    }
+
+protected:
+    virtual int_type overflow(int_type c)
+    {
+        if(c != traits_type::eof()) chunk_.push_back((char)c);
+        return traits_type::not_eof(c);
+    }
+
+    virtual std::streamsize xsputn(const char* s, std::streamsize n)
+    {
+        chunk_.append(s, n);
+        return n;
+    }
+
+private:
+    std::string& chunk_;
+};
+
+// FNV-1a style checksum that mixes in 8 bytes at a time.
+inline uint64_t bstsChecksum(uint64_t hash, const char* data, size_t length)
+{
+    const uint64_t prime = 1099511628211ULL;
+    size_t i = 0;
+    for(; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for(; i < length; ++i)
+    {
+        hash = (hash ^ (unsigned char)data[i]) * prime;
+    }
+    return hash;
+}
+
+#define BSTS_CHECKSUM_SEED 14695981039346656037ULL
+
+inline void bstsWriteU32(std::ostream& out, uint32_t v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); }
+inline void bstsWriteU64(std::ostream& out, uint64_t v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); }
+inline uint32_t bstsReadU32(std::istream& in) { uint32_t v = 0; in.read(reinterpret_cast<char*>(&v), sizeof(v)); return v; }
+inline uint64_t bstsReadU64(std::istream& in) { uint64_t v = 0; in.read(reinterpret_cast<char*>(&v), sizeof(v)); return v; }
+
+/**
+* Streams an in-order sequence of entries to a snapshot file, one chunk
+* of up to BSTS_CHUNK_ENTRIES entries per write.
+*/
+template<typename Key, typename Value>
+class BSTSnapshotWriter
+{
+public:
+    explicit BSTSnapshotWriter(const std::string& path);
+
+    void put(const std::pair<const Key, Value>& item);
+    void finish();
+
+    static const bool rawKeys = std::is_trivially_copyable<Key>::value;
+    static const bool rawValues = std::is_trivially_copyable<Value>::value;
+
+private:
+    void flushChunk();
+
+    std::ofstream out_;
+    std::string chunk_;
+    BSTSChunkBuf chunkBuf_;
+    std::ostream stream_;       // writes into chunk_ through chunkBuf_
+    uint64_t chunkEntries_;
+    uint64_t totalEntries_;
+    uint64_t checksum_;
+};
+
+template<typename Key, typename Value>
+BSTSnapshotWriter<Key, Value>::BSTSnapshotWriter(const std::string& path) :
+    out_(path.c_str(), std::ios::binary | std::ios::trunc),
+    chunkBuf_(chunk_),
+    stream_(&chunkBuf_),
+    chunkEntries_(0),
+    totalEntries_(0),
+    checksum_(BSTS_CHECKSUM_SEED)
+{
+    if(!out_)
+    {
+        throw std::runtime_error("Unable to open " + path + " for writing");
+    }
+    out_.write("BSTS", 4);
+    bstsWriteU32(out_, BSTS_VERSION);
+    bstsWriteU32(out_, (rawKeys ? BSTS_RAW_KEYS : 0) | (rawValues ? BSTS_RAW_VALUES : 0));
+    bstsWriteU32(out_, rawKeys ? sizeof(Key) : 0);
+    bstsWriteU32(out_, rawValues ? sizeof(Value) : 0);
+    bstsWriteU64(out_, 0); // entry count, patched in finish()
+    if(rawKeys && rawValues)
+    {
+        chunk_.reserve(BSTS_CHUNK_ENTRIES * (sizeof(Key) + sizeof(Value)));
+    }
+}
+
+template<typename Key, typename Value>
+void BSTSnapshotWriter<Key, Value>::put(const std::pair<const Key, Value>& item)
+{
+    if(rawKeys && rawValues)
+    {
+        chunk_.append(reinterpret_cast<const char*>(&item.first), sizeof(Key));
+        chunk_.append(reinterpret_cast<const char*>(&item.second), sizeof(Value));
+    }
+    else
+    {
+        BSTSnapshotField<Key>::write(stream_, item.first);
+        BSTSnapshotField<Value>::write(stream_, item.second);
+    }
+    if(++chunkEntries_ == BSTS_CHUNK_ENTRIES)
+    {
+        flushChunk();
+    }
+}
+
+template<typename Key, typename Value>
+void BSTSnapshotWriter<Key, Value>::flushChunk()
+{
+    if(chunkEntries_ == 0)
+    {
+        return;
+    }
+    bstsWriteU64(out_, chunkEntries_);
+    bstsWriteU64(out_, chunk_.size());
+    out_.write(chunk_.data(), chunk_.size());
+    checksum_ = bstsChecksum(checksum_, chunk_.data(), chunk_.size());
+    totalEntries_ += chunkEntries_;
+    chunkEntries_ = 0;
+    chunk_.clear();
+}
+
+template<typename Key, typename Value>
+void BSTSnapshotWriter<Key, Value>::finish()
+{
+    flushChunk();
+    bstsWriteU64(out_, checksum_);
+    out_.seekp(4 + 4 * sizeof(uint32_t));
+    bstsWriteU64(out_, totalEntries_);
+    out_.close();
+    if(!out_)
+    {
+        throw std::runtime_error("Failed writing snapshot");
+    }
+}
+
+/**
+* Reads the entries of a snapshot file back in order, one chunk at a time.
+*/
+template<typename Key, typename Value>
+class BSTSnapshotReader
+{
+public:
+    explicit BSTSnapshotReader(const std::string& path);
+
+    uint64_t size() const;
+    void next(Key& key, Value& value);
+    void finish();
+
+private:
+    void readChunk();
+
+    std::ifstream in_;
+    std::string chunk_;
+    BSTSChunkBuf chunkBuf_;
+    std::istream stream_;       // reads from chunk_ through chunkBuf_
+    size_t pos_;
+    uint64_t count_;
+    uint64_t chunkLeft_;
+    uint64_t fileLeft_;         // unread bytes after the header
+    uint64_t checksum_;
+};
+
+template<typename Key, typename Value>
+BSTSnapshotReader<Key, Value>::BSTSnapshotReader(const std::string& path) :
+    in_(path.c_str(), std::ios::binary),
+    chunkBuf_(chunk_),
+    stream_(&chunkBuf_),
+    pos_(0),
+    count_(0),
+    chunkLeft_(0),
+    fileLeft_(0),
+    checksum_(BSTS_CHECKSUM_SEED)
+{
+    if(!in_)
+    {
+        throw std::runtime_error("Unable to open " + path + " for reading");
+    }
+    char magic[4] = { 0, 0, 0, 0 };
+    in_.read(magic, 4);
+    if(!in_ || std::memcmp(magic, "BSTS", 4) != 0)
+    {
+        throw std::runtime_error(path + " is not a tree snapshot");
+    }
+    if(bstsReadU32(in_) != BSTS_VERSION)
+    {
+        throw std::runtime_error(path + " has an unsupported snapshot version");
+    }
+    const bool rawKeys = BSTSnapshotWriter<Key, Value>::rawKeys;
+    const bool rawValues = BSTSnapshotWriter<Key, Value>::rawValues;
+    uint32_t flags = bstsReadU32(in_);
+    uint32_t keySize = bstsReadU32(in_);
+    uint32_t valueSize = bstsReadU32(in_);
+    if(flags != (uint32_t)((rawKeys ? BSTS_RAW_KEYS : 0) | (rawValues ? BSTS_RAW_VALUES : 0)) ||
+       keySize != (rawKeys ? sizeof(Key) : 0) || valueSize != (rawValues ? sizeof(Value) : 0))
+    {
+        throw std::runtime_error(path + " was written for different key/value types");
+    }
+    count_ = bstsReadU64(in_);
+    if(!in_)
+    {
+        throw std::runtime_error(path + " is truncated");
+    }
+    std::streampos body = in_.tellg();
+    in_.seekg(0, std::ios::end);
+    fileLeft_ = (uint64_t)(in_.tellg() - body);
+    in_.seekg(body);
+}
+
+template<typename Key, typename Value>
+uint64_t BSTSnapshotReader<Key, Value>::size() const
+{
+    return count_;
+}
+
+/**
+* The chunk length comes from the file, so it is checked against what is
+* left of the file (and, for raw entries, against the entry count)
+* before anything is allocated for it.
+*/
+template<typename Key, typename Value>
+void BSTSnapshotReader<Key, Value>::readChunk()
+{
+    chunkLeft_ = bstsReadU64(in_);
+    uint64_t length = bstsReadU64(in_);
+    if(!in_ || chunkLeft_ == 0 || chunkLeft_ > BSTS_CHUNK_ENTRIES || fileLeft_ < 2 * sizeof(uint64_t))
+    {
+        throw std::runtime_error("Corrupt or truncated snapshot");
+    }
+    fileLeft_ -= 2 * sizeof(uint64_t);
+    const bool raw = BSTSnapshotWriter<Key, Value>::rawKeys && BSTSnapshotWriter<Key, Value>::rawValues;
+    if(length > fileLeft_ || (raw && length != chunkLeft_ * (sizeof(Key) + sizeof(Value))))
+    {
+        throw std::runtime_error("Corrupt or truncated snapshot");
+    }
+    fileLeft_ -= length;
+    chunk_.resize(length);
+    in_.read(&chunk_[0], length);
+    if(!in_)
+    {
+        throw std::runtime_error("Corrupt or truncated snapshot");
+    }
+    checksum_ = bstsChecksum(checksum_, chunk_.data(), chunk_.size());
+    pos_ = 0;
+    if(!(BSTSnapshotWriter<Key, Value>::rawKeys && BSTSnapshotWriter<Key, Value>::rawValues))
+    {
+        stream_.clear();
+        chunkBuf_.rewind();
+    }
+}
+
+template<typename Key, typename Value>
+void BSTSnapshotReader<Key, Value>::next(Key& key, Value& value)
+{
+    if(chunkLeft_ == 0)
+    {
+        readChunk();
+    }
+    if(BSTSnapshotWriter<Key, Value>::rawKeys && BSTSnapshotWriter<Key, Value>::rawValues)
+    {
+        if(pos_ + sizeof(Key) + sizeof(Value) > chunk_.size())
+        {
+            throw std::runtime_error("Corrupt snapshot chunk");
+        }
+        std::memcpy(reinterpret_cast<char*>(&key), chunk_.data() + pos_, sizeof(Key));
+        pos_ += sizeof(Key);
+        std::memcpy(reinterpret_cast<char*>(&value), chunk_.data() + pos_, sizeof(Value));
+        pos_ += sizeof(Value);
+    }
+    else
+    {
+        BSTSnapshotField<Key>::read(stream_, key);
+        BSTSnapshotField<Value>::read(stream_, value);
+        if(!stream_)
+        {
+            throw std::runtime_error("Corrupt snapshot chunk");
+        }
+    }
+    --chunkLeft_;
+}
+
+template<typename Key, typename Value>
+void BSTSnapshotReader<Key, Value>::finish()
+{
+    uint64_t stored = bstsReadU64(in_);
+    if(!in_ || chunkLeft_ != 0 || stored != checksum_)
+    {
+        throw std::runtime_error("Snapshot checksum mismatch");
+    }
+}
+
+/**
+* Writes the in-order key/value stream of the tree to a snapshot file.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::save(const std::string& path) const
+{
+    BSTSnapshotWriter<Key, Value> out(path);
+    for(iterator it = begin(); it != end(); ++it)
+    {
+        out.put(*it);
+    }
+    out.finish();
+}
+
+/**
+* Replaces the contents of the tree with a snapshot written by save().
+* The sorted stream is built straight into a balanced tree in O(n).
+* The tree is left untouched if the file is unreadable or corrupt.
+*/
+template<typename Key, typename Value>
+void BinarySearchTree<Key, Value>::load(const std::string& path)
+{
+    BSTSnapshotReader<Key, Value> in(path);
+    int height = 0;
+    Node<Key, Value>* root = buildBalanced(in, in.size(), NULL, height);
+    try
+    {
+        in.finish();
+    }
+    catch(...)
+    {
+        clearHelper(root);
+        throw;
+    }
+    clear();
+    root_ = root;
+    size_ = in.size();
+    maxSize_ = size_;
+    reindex();
+}
+
+/**
+* Builds a perfectly balanced subtree out of the next n entries of in.
+* Partially built subtrees are freed if reading fails.
+*/
+template<typename Key, typename Value>
+template<typename Reader>
+Node<Key, Value>* BinarySearchTree<Key, Value>::buildBalanced(Reader& in, uint64_t n, Node<Key, Value>* parent, int& height)
+{
+    if(n == 0)
+    {
+        height = 0;
+        return NULL;
+    }
+    uint64_t leftCount = (n - 1) / 2;
+    int leftHeight = 0;
+    int rightHeight = 0;
+    Node<Key, Value>* left = buildBalanced(in, leftCount, NULL, leftHeight);
+
+    Node<Key, Value>* node;
+    try
+    {
+        Key key;
+        Value value;
+        in.next(key, value);
+        node = makeNode(key, value, parent);
+    }
+    catch(...)
+    {
+        clearHelper(left);
+        throw;
+    }
+    node->setLeft(left);
+    if(left != NULL) left->setParent(node);
+
+    try
+    {
+        node->setRight(buildBalanced(in, n - 1 - leftCount, node, rightHeight));
+    }
+    catch(...)
+    {
+        clearHelper(node);
+        throw;
+    }
+    setBuiltHeights(node, leftHeight, rightHeight);
+    height = std::max(leftHeight, rightHeight) + 1;
+    return node;
+}
+
+#endif
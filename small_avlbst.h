@@ -0,0 +1,477 @@
+#ifndef SMALL_AVLBST_H
+#define SMALL_AVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "avlbst.h"
+
+// Entries a SmallAVLTree keeps inline before it promotes to an AVLTree
+#define SMALL_AVL_INLINE 16
+// iterator index meaning "not in the inline array" (tree mode or end)
+#define SMALL_AVL_END ((size_t)-1)
+
+/**
+* A map for many small key sets. Up to N entries are kept inline in a
+* sorted array inside the object, with no allocation at all; inserting
+* the (N+1)th key moves them into an AVLTree, built in one O(N) pass.
+* Removing back down to N/2 entries moves them inline again, so a map
+* that hovers around N does not flip on every insert and remove.
+*
+* It offers the same interface as BinarySearchTree/AVLTree, and its
+* iterator walks either representation in key order. Like a vector,
+* insert() and remove() invalidate iterators while the map is inline
+* or when it changes representation.
+*/
+template <typename Key, typename Value, size_t N = SMALL_AVL_INLINE>
+class SmallAVLTree
+{
+public:
+    SmallAVLTree();
+    SmallAVLTree(const SmallAVLTree<Key, Value, N>& other);
+    SmallAVLTree<Key, Value, N>& operator=(const SmallAVLTree<Key, Value, N>& other);
+    ~SmallAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+    bool promoted() const;
+    size_t memoryBytes() const;
+
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key, Value>& operator*() const;
+        std::pair<const Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class SmallAVLTree<Key, Value, N>;
+        iterator(const SmallAVLTree<Key, Value, N>* map, size_t index, typename AVLTree<Key, Value>::iterator treeIt);
+        const SmallAVLTree<Key, Value, N>* map_;
+        size_t index_;
+        typename AVLTree<Key, Value>::iterator treeIt_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    typedef std::pair<const Key, Value> Item;
+
+    // An AVLTree that reports whether an insert or remove changed the
+    // key set, so size_ stays exact after promotion.
+    class Tree : public AVLTree<Key, Value>
+    {
+    public:
+        bool insertItem(const Key& key, const Value& value)
+        {
+            bool inserted;
+            Node<Key, Value>* n = this -> findOrInsert(key, value, inserted);
+            if (!inserted) {
+                n -> setValue(value);
+            }
+            return inserted;
+        }
+        bool removeItem(const Key& key)
+        {
+            Node<Key, Value>* n = this -> internalFind(key);
+            if (n == NULL) {
+                return false;
+            }
+            this -> eraseNode(n);
+            return true;
+        }
+    };
+
+    Item* item(size_t i) const;
+    size_t lowerBound(const Key& key) const;
+    void insertInline(size_t pos, const Key& key, const Value& value);
+    void removeInline(size_t pos);
+    void promote(size_t pos, const Key& key, const Value& value);
+    void demote();
+    void copyFrom(const SmallAVLTree<Key, Value, N>& other);
+
+    // raw storage for the first size_ items when tree_ is NULL
+    mutable typename std::aligned_storage<sizeof(Item), alignof(Item)>::type slots_[N];
+    size_t size_;
+    Tree* tree_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the SmallAVLTree::iterator class.
+  -----------------------------------------------
+*/
+
+template<class Key, class Value, size_t N>
+SmallAVLTree<Key, Value, N>::iterator::iterator() :
+    map_(NULL),
+    index_(SMALL_AVL_END)
+{
+
+}
+
+template<class Key, class Value, size_t N>
+SmallAVLTree<Key, Value, N>::iterator::iterator(const SmallAVLTree<Key, Value, N>* map, size_t index,
+    typename AVLTree<Key, Value>::iterator treeIt) :
+    map_(map),
+    index_(index),
+    treeIt_(treeIt)
+{
+
+}
+
+template<class Key, class Value, size_t N>
+std::pair<const Key, Value>& SmallAVLTree<Key, Value, N>::iterator::operator*() const
+{
+    return (index_ != SMALL_AVL_END) ? *map_->item(index_) : *treeIt_;
+}
+
+template<class Key, class Value, size_t N>
+std::pair<const Key, Value>* SmallAVLTree<Key, Value, N>::iterator::operator->() const
+{
+    return &(**this);
+}
+
+/**
+* The end iterator is the same in both representations: no inline index
+* and a NULL tree iterator.
+*/
+template<class Key, class Value, size_t N>
+bool SmallAVLTree<Key, Value, N>::iterator::operator==(const iterator& rhs) const
+{
+    return index_ == rhs.index_ && treeIt_ == rhs.treeIt_;
+}
+
+template<class Key, class Value, size_t N>
+bool SmallAVLTree<Key, Value, N>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<class Key, class Value, size_t N>
+typename SmallAVLTree<Key, Value, N>::iterator& SmallAVLTree<Key, Value, N>::iterator::operator++()
+{
+    if (index_ != SMALL_AVL_END) {
+        if (++index_ == map_->size_) {
+            index_ = SMALL_AVL_END;
+        }
+    }
+    else {
+        ++treeIt_;
+    }
+    return *this;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the SmallAVLTree::iterator class.
+  -----------------------------------------------
+*/
+
+/*
+  -----------------------------------------------
+  Begin implementations for the SmallAVLTree class.
+  -----------------------------------------------
+*/
+
+template<class Key, class Value, size_t N>
+SmallAVLTree<Key, Value, N>::SmallAVLTree() :
+    size_(0),
+    tree_(NULL)
+{
+
+}
+
+template<class Key, class Value, size_t N>
+SmallAVLTree<Key, Value, N>::SmallAVLTree(const SmallAVLTree<Key, Value, N>& other) :
+    size_(0),
+    tree_(NULL)
+{
+    copyFrom(other);
+}
+
+template<class Key, class Value, size_t N>
+SmallAVLTree<Key, Value, N>& SmallAVLTree<Key, Value, N>::operator=(const SmallAVLTree<Key, Value, N>& other)
+{
+    if (this != &other) {
+        clear();
+        copyFrom(other);
+    }
+    return *this;
+}
+
+template<class Key, class Value, size_t N>
+SmallAVLTree<Key, Value, N>::~SmallAVLTree()
+{
+    clear();
+}
+
+/**
+* If the key is already present, its value is overwritten.
+*/
+template<class Key, class Value, size_t N>
+void SmallAVLTree<Key, Value, N>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    const Key& key = keyValuePair.first;
+    if (tree_ != NULL) {
+        if (tree_ -> insertItem(key, keyValuePair.second)) {
+            ++size_;
+        }
+        return;
+    }
+    size_t pos = lowerBound(key);
+    if (pos < size_ && !(key < item(pos) -> first)) {
+        item(pos) -> second = keyValuePair.second;
+    }
+    else if (size_ < N) {
+        insertInline(pos, key, keyValuePair.second);
+    }
+    else {
+        promote(pos, key, keyValuePair.second);
+    }
+}
+
+template<class Key, class Value, size_t N>
+void SmallAVLTree<Key, Value, N>::remove(const Key& key)
+{
+    if (tree_ != NULL) {
+        if (tree_ -> removeItem(key) && --size_ <= N / 2) {
+            demote();
+        }
+        return;
+    }
+    size_t pos = lowerBound(key);
+    if (pos < size_ && !(key < item(pos) -> first)) {
+        removeInline(pos);
+    }
+}
+
+template<class Key, class Value, size_t N>
+void SmallAVLTree<Key, Value, N>::clear()
+{
+    if (tree_ != NULL) {
+        delete tree_;
+        tree_ = NULL;
+    }
+    else {
+        for (size_t i = 0; i < size_; ++i) {
+            item(i) -> ~Item();
+        }
+    }
+    size_ = 0;
+}
+
+template<class Key, class Value, size_t N>
+bool SmallAVLTree<Key, Value, N>::empty() const
+{
+    return size_ == 0;
+}
+
+template<class Key, class Value, size_t N>
+size_t SmallAVLTree<Key, Value, N>::size() const
+{
+    return size_;
+}
+
+/**
+* Returns true while the entries live in an AVLTree.
+*/
+template<class Key, class Value, size_t N>
+bool SmallAVLTree<Key, Value, N>::promoted() const
+{
+    return tree_ != NULL;
+}
+
+/**
+* The object itself, which includes the inline array, plus the tree
+* once promoted.
+*/
+template<class Key, class Value, size_t N>
+size_t SmallAVLTree<Key, Value, N>::memoryBytes() const
+{
+    return sizeof(*this) + ((tree_ != NULL) ? tree_ -> memoryUsage().totalBytes() : 0);
+}
+
+template<class Key, class Value, size_t N>
+typename SmallAVLTree<Key, Value, N>::iterator SmallAVLTree<Key, Value, N>::begin() const
+{
+    if (tree_ != NULL) {
+        return iterator(this, SMALL_AVL_END, tree_ -> begin());
+    }
+    return (size_ == 0) ? end() : iterator(this, 0, typename AVLTree<Key, Value>::iterator());
+}
+
+template<class Key, class Value, size_t N>
+typename SmallAVLTree<Key, Value, N>::iterator SmallAVLTree<Key, Value, N>::end() const
+{
+    return iterator(this, SMALL_AVL_END, typename AVLTree<Key, Value>::iterator());
+}
+
+template<class Key, class Value, size_t N>
+typename SmallAVLTree<Key, Value, N>::iterator SmallAVLTree<Key, Value, N>::find(const Key& key) const
+{
+    if (tree_ != NULL) {
+        return iterator(this, SMALL_AVL_END, tree_ -> find(key));
+    }
+    size_t pos = lowerBound(key);
+    if (pos < size_ && !(key < item(pos) -> first)) {
+        return iterator(this, pos, typename AVLTree<Key, Value>::iterator());
+    }
+    return end();
+}
+
+template<class Key, class Value, size_t N>
+Value& SmallAVLTree<Key, Value, N>::operator[](const Key& key)
+{
+    iterator it = find(key);
+    if (it == end()) throw std::out_of_range("Invalid key");
+    return it -> second;
+}
+
+template<class Key, class Value, size_t N>
+Value const & SmallAVLTree<Key, Value, N>::operator[](const Key& key) const
+{
+    iterator it = find(key);
+    if (it == end()) throw std::out_of_range("Invalid key");
+    return it -> second;
+}
+
+template<class Key, class Value, size_t N>
+typename SmallAVLTree<Key, Value, N>::Item* SmallAVLTree<Key, Value, N>::item(size_t i) const
+{
+    return reinterpret_cast<Item*>(&slots_[i]);
+}
+
+/**
+* Binary search of the inline array: the first index whose key is not
+* less than key, or size_.
+*/
+template<class Key, class Value, size_t N>
+size_t SmallAVLTree<Key, Value, N>::lowerBound(const Key& key) const
+{
+    size_t lo = 0;
+    size_t hi = size_;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (item(mid) -> first < key) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+* Opens a gap at pos by moving the later items up one slot. The keys are
+* const, so each item is move-constructed into its new slot and the old
+* one destroyed.
+*/
+template<class Key, class Value, size_t N>
+void SmallAVLTree<Key, Value, N>::insertInline(size_t pos, const Key& key, const Value& value)
+{
+    for (size_t i = size_; i > pos; --i) {
+        new (item(i)) Item(std::move(*item(i - 1)));
+        item(i - 1) -> ~Item();
+    }
+    new (item(pos)) Item(key, value);
+    ++size_;
+}
+
+template<class Key, class Value, size_t N>
+void SmallAVLTree<Key, Value, N>::removeInline(size_t pos)
+{
+    item(pos) -> ~Item();
+    for (size_t i = pos + 1; i < size_; ++i) {
+        new (item(i - 1)) Item(std::move(*item(i)));
+        item(i) -> ~Item();
+    }
+    --size_;
+}
+
+/**
+* Moves the N inline items plus the new one at pos into a tree, linked
+* straight from the sorted run by insert_batch().
+*/
+template<class Key, class Value, size_t N>
+void SmallAVLTree<Key, Value, N>::promote(size_t pos, const Key& key, const Value& value)
+{
+    std::vector<std::pair<Key, Value> > items;
+    items.reserve(size_ + 1);
+    for (size_t i = 0; i < size_; ++i) {
+        if (i == pos) {
+            items.push_back(std::pair<Key, Value>(key, value));
+        }
+        items.push_back(std::pair<Key, Value>(item(i) -> first, std::move(item(i) -> second)));
+    }
+    if (pos == size_) {
+        items.push_back(std::pair<Key, Value>(key, value));
+    }
+    Tree* tree = new Tree;
+    tree -> insert_batch(items.begin(), items.end());
+    size_t count = items.size();
+    clear();
+    tree_ = tree;
+    size_ = count;
+}
+
+template<class Key, class Value, size_t N>
+void SmallAVLTree<Key, Value, N>::demote()
+{
+    Tree* tree = tree_;
+    tree_ = NULL;
+    size_t i = 0;
+    for (typename AVLTree<Key, Value>::iterator it = tree -> begin(); it != tree -> end(); ++it, ++i) {
+        new (item(i)) Item(it -> first, std::move(it -> second));
+    }
+    size_ = i;
+    delete tree;
+}
+
+template<class Key, class Value, size_t N>
+void SmallAVLTree<Key, Value, N>::copyFrom(const SmallAVLTree<Key, Value, N>& other)
+{
+    if (other.tree_ != NULL) {
+        std::vector<std::pair<Key, Value> > items;
+        items.reserve(other.size_);
+        for (iterator it = other.begin(); it != other.end(); ++it) {
+            items.push_back(std::pair<Key, Value>(it -> first, it -> second));
+        }
+        tree_ = new Tree;
+        tree_ -> insert_batch(items.begin(), items.end());
+    }
+    else {
+        for (size_t i = 0; i < other.size_; ++i) {
+            new (item(i)) Item(*other.item(i));
+        }
+    }
+    size_ = other.size_;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the SmallAVLTree class.
+  -----------------------------------------------
+*/
+
+#endif
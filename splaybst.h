@@ -0,0 +1,300 @@
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include "bst.h"
+
+/**
+* A splay tree. Every insert and lookup rotates the node it reached up
+* to the root, so frequently used keys stay near the top.
+*
+* Two options trade adaptivity for fewer writes on lookups:
+*  - splayInterval k > 1 only splays on every k-th lookup
+*  - semiSplay only lifts the parent in the zig-zig case, which roughly
+*    halves the access path instead of moving the node all the way up
+*
+* Lookups through a const tree use the plain BinarySearchTree versions
+* and never change the shape.
+*
+* With enableHashIndex() a lookup finds the node through the index and
+* then splays it, skipping the descent. A miss then never touches the
+* tree, so it splays nothing. The same goes for a key the Bloom filter
+* (enableBloomFilter()) rules out.
+*/
+template <class Key, class Value>
+class SplayTree : public BinarySearchTree<Key, Value>
+{
+public:
+    explicit SplayTree(unsigned int splayInterval = 1, bool semiSplay = false);
+
+    using BinarySearchTree<Key, Value>::find;
+    using BinarySearchTree<Key, Value>::operator[];
+    typename BinarySearchTree<Key, Value>::iterator find(const Key& key);
+    Value& operator[](const Key& key);
+
+protected:
+    virtual Node<Key, Value>* findOrInsert(const Key& key, const Value& value, bool& inserted);
+    virtual void eraseNode(Node<Key, Value>* n);
+    Node<Key, Value>* access(const Key& key);
+    bool splayThisAccess();
+    void splay(Node<Key, Value>* n);
+    void rotateUp(Node<Key, Value>* n);
+    virtual size_t treeBytes() const;
+    virtual bool rebalancesItself() const;
+
+    unsigned int splayInterval_;
+    unsigned int accesses_;
+    bool semiSplay_;
+};
+
+/*
+--------------------------------------------
+Begin implementations for the SplayTree class.
+--------------------------------------------
+*/
+
+template<class Key, class Value>
+SplayTree<Key, Value>::SplayTree(unsigned int splayInterval, bool semiSplay) :
+    splayInterval_(splayInterval), accesses_(0), semiSplay_(semiSplay)
+{
+
+}
+
+/**
+* Returns the node with the given key, inserting one holding value if
+* there is none. The found (or inserted) node is splayed to the root.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::findOrInsert(const Key& key, const Value& value, bool& inserted)
+{
+    Node<Key, Value>* parent = NULL;
+    Node<Key, Value>* curr = this->root_;
+    while(curr != NULL) {
+        BST_COUNT(comparisons);
+        if(key == curr->getKey()) {
+            splay(curr);
+            inserted = false;
+            return curr;
+        }
+        parent = curr;
+        curr = (key < curr->getKey()) ? curr->getLeft() : curr->getRight();
+    }
+
+    Node<Key, Value>* n = new Node<Key, Value>(key, value, parent);
+    BST_COUNT(allocations);
+    this->indexInsert(n);
+    if(parent == NULL) {
+        this->root_ = n;
+    }
+    else if(key < parent->getKey()) {
+        parent->setLeft(n);
+    }
+    else {
+        parent->setRight(n);
+    }
+    splay(n);
+    inserted = true;
+    return n;
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ * The removed node's parent is splayed afterwards.
+ */
+template<class Key, class Value>
+void SplayTree<Key, Value>::eraseNode(Node<Key, Value>* n)
+{
+    if(n->getLeft() != NULL && n->getRight() != NULL) {
+        this->nodeSwap(n, BinarySearchTree<Key, Value>::predecessor(n));
+    }
+
+    Node<Key, Value>* p = n->getParent();
+    Node<Key, Value>* child = (n->getLeft() != NULL) ? n->getLeft() : n->getRight();
+    if(child != NULL) {
+        child->setParent(p);
+    }
+    if(p == NULL) {
+        this->root_ = child;
+    }
+    else if(n == p->getLeft()) {
+        p->setLeft(child);
+    }
+    else {
+        p->setRight(child);
+    }
+    this->indexErase(n);
+    delete n;
+    BST_COUNT(frees);
+
+    if(p != NULL) {
+        splay(p);
+    }
+}
+
+/**
+* Returns an iterator to the item with the given key, or end(),
+* splaying the node the search stopped at.
+*/
+template<class Key, class Value>
+typename BinarySearchTree<Key, Value>::iterator SplayTree<Key, Value>::find(const Key& key)
+{
+    BST_TIME(find);
+    return BinarySearchTree<Key, Value>::makeIterator(access(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& SplayTree<Key, Value>::operator[](const Key& key)
+{
+    Node<Key, Value>* curr = access(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+/**
+* Looks up key and, if this access is due for it, splays the matching
+* node (or the last node visited on a miss). Returns NULL on a miss.
+*/
+template<class Key, class Value>
+Node<Key, Value>* SplayTree<Key, Value>::access(const Key& key)
+{
+    BST_COUNT(finds);
+    if(this->filter_ != NULL && !this->filter_->mayContain(key)) {
+        BST_COUNT(filterRejects);
+        return NULL;
+    }
+    if(this->index_ != NULL) {
+        Node<Key, Value>* n = this->index_->find(key);
+        if(splayThisAccess()) {
+            splay(n);
+        }
+        return n;
+    }
+    Node<Key, Value>* last = NULL;
+    Node<Key, Value>* curr = this->root_;
+    while(curr != NULL) {
+        BST_COUNT(findVisits);
+        BST_COUNT(comparisons);
+        if(key == curr->getKey()) {
+            break;
+        }
+        last = curr;
+        curr = (key < curr->getKey()) ? curr->getLeft() : curr->getRight();
+    }
+    if(splayThisAccess()) {
+        splay((curr != NULL) ? curr : last);
+    }
+    return curr;
+}
+
+template<class Key, class Value>
+bool SplayTree<Key, Value>::splayThisAccess()
+{
+    if(splayInterval_ <= 1) {
+        return true;
+    }
+    if(++accesses_ < splayInterval_) {
+        return false;
+    }
+    accesses_ = 0;
+    return true;
+}
+
+/**
+* Moves n up towards the root with zig, zig-zig and zig-zag steps.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::splay(Node<Key, Value>* n)
+{
+    if(n == NULL) {
+        return;
+    }
+    Node<Key, Value>* p;
+    while((p = n->getParent()) != NULL) {
+        Node<Key, Value>* g = p->getParent();
+        if(g == NULL) {
+            //zig
+            BST_COUNT(singleRotations);
+            rotateUp(n);
+        }
+        else if((n == p->getLeft()) == (p == g->getLeft())) {
+            //zig-zig
+            rotateUp(p);
+            if(semiSplay_) {
+                BST_COUNT(singleRotations);
+                n = p;
+            }
+            else {
+                BST_COUNT(doubleRotations);
+                rotateUp(n);
+            }
+        }
+        else {
+            //zig-zag
+            BST_COUNT(doubleRotations);
+            rotateUp(n);
+            rotateUp(n);
+        }
+    }
+}
+
+/**
+* Rotates n above its parent.
+*/
+template<class Key, class Value>
+void SplayTree<Key, Value>::rotateUp(Node<Key, Value>* n)
+{
+    Node<Key, Value>* p = n->getParent();
+    Node<Key, Value>* g = p->getParent();
+    if(n == p->getLeft()) {
+        p->setLeft(n->getRight());
+        if(n->getRight() != NULL) {
+            n->getRight()->setParent(p);
+        }
+        n->setRight(p);
+    }
+    else {
+        p->setRight(n->getLeft());
+        if(n->getLeft() != NULL) {
+            n->getLeft()->setParent(p);
+        }
+        n->setLeft(p);
+    }
+    p->setParent(n);
+    n->setParent(g);
+    if(g == NULL) {
+        this->root_ = n;
+    }
+    else if(g->getLeft() == p) {
+        g->setLeft(n);
+    }
+    else {
+        g->setRight(n);
+    }
+}
+
+template<class Key, class Value>
+size_t SplayTree<Key, Value>::treeBytes() const
+{
+    return sizeof(*this);
+}
+
+template<class Key, class Value>
+bool SplayTree<Key, Value>::rebalancesItself() const
+{
+    return true;
+}
+
+/*
+------------------------------------------
+End implementations for the SplayTree class.
+------------------------------------------
+*/
+
+#endif
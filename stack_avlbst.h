@@ -0,0 +1,585 @@
+#ifndef STACK_AVLBST_H
+#define STACK_AVLBST_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <utility>
+
+// Deepest path the explicit stacks can hold. An AVL tree of height 64
+// needs more than 10^13 nodes, so this never limits a real tree.
+#define STACK_AVL_MAX_HEIGHT 64
+
+/**
+* A node for StackAVLTree. Unlike AVLNode it has no parent pointer and
+* no virtual functions, which saves 16 bytes per node and the parent
+* writes on every rotation.
+*/
+template <typename Key, typename Value>
+class StackAVLNode
+{
+public:
+    StackAVLNode(const Key& key, const Value& value);
+
+    std::pair<const Key, Value>& getItem();
+    const Key& getKey() const;
+    Value& getValue();
+    void setValue(const Value& value);
+
+    StackAVLNode<Key, Value>* getLeft() const;
+    StackAVLNode<Key, Value>* getRight() const;
+    void setLeft(StackAVLNode<Key, Value>* left);
+    void setRight(StackAVLNode<Key, Value>* right);
+
+    int8_t getBalance() const;
+    void setBalance(int8_t balance);
+
+protected:
+    std::pair<const Key, Value> item_;
+    StackAVLNode<Key, Value>* left_;
+    StackAVLNode<Key, Value>* right_;
+    int8_t balance_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the StackAVLNode class.
+  -------------------------------------------------
+*/
+
+template<class Key, class Value>
+StackAVLNode<Key, Value>::StackAVLNode(const Key& key, const Value& value) :
+    item_(key, value),
+    left_(NULL),
+    right_(NULL),
+    balance_(0)
+{
+
+}
+
+template<class Key, class Value>
+std::pair<const Key, Value>& StackAVLNode<Key, Value>::getItem()
+{
+    return item_;
+}
+
+template<class Key, class Value>
+const Key& StackAVLNode<Key, Value>::getKey() const
+{
+    return item_.first;
+}
+
+template<class Key, class Value>
+Value& StackAVLNode<Key, Value>::getValue()
+{
+    return item_.second;
+}
+
+template<class Key, class Value>
+void StackAVLNode<Key, Value>::setValue(const Value& value)
+{
+    item_.second = value;
+}
+
+template<class Key, class Value>
+StackAVLNode<Key, Value>* StackAVLNode<Key, Value>::getLeft() const
+{
+    return left_;
+}
+
+template<class Key, class Value>
+StackAVLNode<Key, Value>* StackAVLNode<Key, Value>::getRight() const
+{
+    return right_;
+}
+
+template<class Key, class Value>
+void StackAVLNode<Key, Value>::setLeft(StackAVLNode<Key, Value>* left)
+{
+    left_ = left;
+}
+
+template<class Key, class Value>
+void StackAVLNode<Key, Value>::setRight(StackAVLNode<Key, Value>* right)
+{
+    right_ = right;
+}
+
+template<class Key, class Value>
+int8_t StackAVLNode<Key, Value>::getBalance() const
+{
+    return balance_;
+}
+
+template<class Key, class Value>
+void StackAVLNode<Key, Value>::setBalance(int8_t balance)
+{
+    balance_ = balance;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the StackAVLNode class.
+  -----------------------------------------------
+*/
+
+/**
+* An AVL tree without parent pointers. insert() and remove() record
+* the path from the root in a fixed-size stack and retrace it upwards,
+* and iterators carry the stack of ancestors they still have to visit.
+*/
+template <class Key, class Value>
+class StackAVLTree
+{
+public:
+    StackAVLTree();
+    ~StackAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key, Value>& operator*() const;
+        std::pair<const Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class StackAVLTree<Key, Value>;
+        void pushLeftSpine(StackAVLNode<Key, Value>* n);
+        StackAVLNode<Key, Value>* current() const;
+
+        // ancestors still to be visited, current node on top
+        StackAVLNode<Key, Value>* stack_[STACK_AVL_MAX_HEIGHT];
+        int depth_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    StackAVLNode<Key, Value>* internalFind(const Key& key) const;
+    static StackAVLNode<Key, Value>* rotateLeft(StackAVLNode<Key, Value>* n);
+    static StackAVLNode<Key, Value>* rotateRight(StackAVLNode<Key, Value>* n);
+    static StackAVLNode<Key, Value>* rebalance(StackAVLNode<Key, Value>* n, int balance, bool& shrunk);
+    void replaceChild(StackAVLNode<Key, Value>** path, int level, StackAVLNode<Key, Value>* child);
+    void clearHelper(StackAVLNode<Key, Value>* curr);
+
+    StackAVLNode<Key, Value>* root_;
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the StackAVLTree::iterator class.
+---------------------------------------------------------------
+*/
+
+template<class Key, class Value>
+StackAVLTree<Key, Value>::iterator::iterator() :
+    depth_(0)
+{
+
+}
+
+template<class Key, class Value>
+StackAVLNode<Key, Value>* StackAVLTree<Key, Value>::iterator::current() const
+{
+    return (depth_ == 0) ? NULL : stack_[depth_ - 1];
+}
+
+template<class Key, class Value>
+std::pair<const Key, Value>& StackAVLTree<Key, Value>::iterator::operator*() const
+{
+    return current()->getItem();
+}
+
+template<class Key, class Value>
+std::pair<const Key, Value>* StackAVLTree<Key, Value>::iterator::operator->() const
+{
+    return &(current()->getItem());
+}
+
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current() == rhs.current();
+}
+
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current() != rhs.current();
+}
+
+/**
+* Pops the current node and, if it has a right subtree, descends to
+* that subtree's smallest node.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator& StackAVLTree<Key, Value>::iterator::operator++()
+{
+    StackAVLNode<Key, Value>* n = stack_[--depth_];
+    pushLeftSpine(n->getRight());
+    return *this;
+}
+
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::iterator::pushLeftSpine(StackAVLNode<Key, Value>* n)
+{
+    while(n != NULL) {
+        stack_[depth_++] = n;
+        n = n->getLeft();
+    }
+}
+
+/*
+-------------------------------------------------------------
+End implementations for the StackAVLTree::iterator class.
+-------------------------------------------------------------
+*/
+
+/*
+-----------------------------------------------------
+Begin implementations for the StackAVLTree class.
+-----------------------------------------------------
+*/
+
+template<class Key, class Value>
+StackAVLTree<Key, Value>::StackAVLTree() :
+    root_(NULL)
+{
+
+}
+
+template<class Key, class Value>
+StackAVLTree<Key, Value>::~StackAVLTree()
+{
+    clear();
+}
+
+template<class Key, class Value>
+bool StackAVLTree<Key, Value>::empty() const
+{
+    return root_ == NULL;
+}
+
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::clear()
+{
+    clearHelper(root_);
+    root_ = NULL;
+}
+
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::clearHelper(StackAVLNode<Key, Value>* curr)
+{
+    if(curr == NULL) {
+        return;
+    }
+    clearHelper(curr->getLeft());
+    clearHelper(curr->getRight());
+    delete curr;
+}
+
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator StackAVLTree<Key, Value>::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator StackAVLTree<Key, Value>::end() const
+{
+    return iterator();
+}
+
+/**
+* Returns an iterator to the item with the given key, or end(). The
+* descent records the ancestors we went left from, which is exactly
+* the stack the iterator needs.
+*/
+template<class Key, class Value>
+typename StackAVLTree<Key, Value>::iterator StackAVLTree<Key, Value>::find(const Key& key) const
+{
+    iterator it;
+    StackAVLNode<Key, Value>* curr = root_;
+    while(curr != NULL) {
+        if(key == curr->getKey()) {
+            it.stack_[it.depth_++] = curr;
+            return it;
+        }
+        if(key < curr->getKey()) {
+            it.stack_[it.depth_++] = curr;
+            curr = curr->getLeft();
+        }
+        else {
+            curr = curr->getRight();
+        }
+    }
+    return end();
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value>
+Value& StackAVLTree<Key, Value>::operator[](const Key& key)
+{
+    StackAVLNode<Key, Value>* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+template<class Key, class Value>
+Value const & StackAVLTree<Key, Value>::operator[](const Key& key) const
+{
+    StackAVLNode<Key, Value>* curr = internalFind(key);
+    if(curr == NULL) throw std::out_of_range("Invalid key");
+    return curr->getValue();
+}
+
+template<class Key, class Value>
+StackAVLNode<Key, Value>* StackAVLTree<Key, Value>::internalFind(const Key& key) const
+{
+    StackAVLNode<Key, Value>* curr = root_;
+    while(curr != NULL) {
+        if(key == curr->getKey()) {
+            return curr;
+        }
+        curr = (key < curr->getKey()) ? curr->getLeft() : curr->getRight();
+    }
+    return NULL;
+}
+
+template<class Key, class Value>
+StackAVLNode<Key, Value>* StackAVLTree<Key, Value>::rotateLeft(StackAVLNode<Key, Value>* n)
+{
+    StackAVLNode<Key, Value>* c = n->getRight();
+    n->setRight(c->getLeft());
+    c->setLeft(n);
+    return c;
+}
+
+template<class Key, class Value>
+StackAVLNode<Key, Value>* StackAVLTree<Key, Value>::rotateRight(StackAVLNode<Key, Value>* n)
+{
+    StackAVLNode<Key, Value>* c = n->getLeft();
+    n->setLeft(c->getRight());
+    c->setRight(n);
+    return c;
+}
+
+/**
+* Restores the AVL property at n, whose balance would be +/-2. Returns
+* the new subtree root and sets shrunk if the subtree lost a level.
+*/
+template<class Key, class Value>
+StackAVLNode<Key, Value>* StackAVLTree<Key, Value>::rebalance(StackAVLNode<Key, Value>* n, int balance, bool& shrunk)
+{
+    int dir = (balance > 0) ? 1 : -1;
+    StackAVLNode<Key, Value>* c = (dir > 0) ? n->getRight() : n->getLeft();
+    int cb = c->getBalance();
+
+    //zig-zig (or a balanced child, which only happens on removal)
+    if(cb != -dir) {
+        StackAVLNode<Key, Value>* top = (dir > 0) ? rotateLeft(n) : rotateRight(n);
+        n->setBalance(cb == 0 ? dir : 0);
+        c->setBalance(cb == 0 ? -dir : 0);
+        shrunk = (cb != 0);
+        return top;
+    }
+
+    //zig-zag
+    StackAVLNode<Key, Value>* g = (dir > 0) ? c->getLeft() : c->getRight();
+    int gb = g->getBalance();
+    if(dir > 0) {
+        n->setRight(rotateRight(c));
+        rotateLeft(n);
+    }
+    else {
+        n->setLeft(rotateLeft(c));
+        rotateRight(n);
+    }
+    n->setBalance(gb == dir ? -dir : 0);
+    c->setBalance(gb == -dir ? dir : 0);
+    g->setBalance(0);
+    shrunk = true;
+    return g;
+}
+
+/**
+* Points the link that referred to path[level] at child instead.
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::replaceChild(StackAVLNode<Key, Value>** path, int level, StackAVLNode<Key, Value>* child)
+{
+    if(level == 0) {
+        root_ = child;
+    }
+    else if(path[level - 1]->getLeft() == path[level]) {
+        path[level - 1]->setLeft(child);
+    }
+    else {
+        path[level - 1]->setRight(child);
+    }
+}
+
+/**
+* Inserts the pair, or overwrites the value if the key is present.
+* The new leaf's path is then retraced until a subtree stops growing,
+* with at most one (single or double) rotation.
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    StackAVLNode<Key, Value>* path[STACK_AVL_MAX_HEIGHT];
+    int depth = 0;
+    StackAVLNode<Key, Value>* curr = root_;
+    while(curr != NULL) {
+        if(keyValuePair.first == curr->getKey()) {
+            curr->setValue(keyValuePair.second);
+            return;
+        }
+        if(depth == STACK_AVL_MAX_HEIGHT - 1) {
+            throw std::length_error("StackAVLTree is too deep");
+        }
+        path[depth++] = curr;
+        curr = (keyValuePair.first < curr->getKey()) ? curr->getLeft() : curr->getRight();
+    }
+
+    StackAVLNode<Key, Value>* child = new StackAVLNode<Key, Value>(keyValuePair.first, keyValuePair.second);
+    if(depth == 0) {
+        root_ = child;
+        return;
+    }
+    StackAVLNode<Key, Value>* p = path[depth - 1];
+    if(keyValuePair.first < p->getKey()) {
+        p->setLeft(child);
+    }
+    else {
+        p->setRight(child);
+    }
+
+    //retrace: child's subtree just grew by one level
+    for(int level = depth - 1; level >= 0; --level) {
+        p = path[level];
+        int b = p->getBalance() + ((child == p->getLeft()) ? -1 : 1);
+        if(b == 0) {
+            p->setBalance(0);
+            return;
+        }
+        if(b == 1 || b == -1) {
+            p->setBalance(b);
+            child = p;
+            continue;
+        }
+        bool shrunk;
+        replaceChild(path, level, rebalance(p, b, shrunk));
+        return;
+    }
+}
+
+/**
+* Removes the key if present. A node with two children is replaced by
+* its in-order predecessor: the predecessor node is unlinked from its
+* spot and relinked in place of the removed node, so no items are
+* copied and iterators to other items stay valid. The path is then
+* retraced until a subtree keeps its height.
+*/
+template<class Key, class Value>
+void StackAVLTree<Key, Value>::remove(const Key& key)
+{
+    StackAVLNode<Key, Value>* path[STACK_AVL_MAX_HEIGHT];
+    int depth = 0;
+    StackAVLNode<Key, Value>* n = root_;
+    while(n != NULL && !(key == n->getKey())) {
+        path[depth++] = n;
+        n = (key < n->getKey()) ? n->getLeft() : n->getRight();
+    }
+    if(n == NULL) {
+        return;
+    }
+    int level = depth;
+    path[depth++] = n;
+
+    bool leftShrunk;
+    if(n->getLeft() != NULL && n->getRight() != NULL) {
+        //find the predecessor, unlink it and put it in n's place
+        StackAVLNode<Key, Value>* pred = n->getLeft();
+        while(pred->getRight() != NULL) {
+            path[depth++] = pred;
+            pred = pred->getRight();
+        }
+        StackAVLNode<Key, Value>* pp = path[depth - 1];
+        if(pp == n) {
+            n->setLeft(pred->getLeft());
+            leftShrunk = true;
+        }
+        else {
+            pp->setRight(pred->getLeft());
+            leftShrunk = false;
+        }
+        pred->setLeft(n->getLeft());
+        pred->setRight(n->getRight());
+        pred->setBalance(n->getBalance());
+        replaceChild(path, level, pred);
+        path[level] = pred;
+    }
+    else {
+        StackAVLNode<Key, Value>* child = (n->getLeft() != NULL) ? n->getLeft() : n->getRight();
+        leftShrunk = (level > 0 && path[level - 1]->getLeft() == n);
+        replaceChild(path, level, child);
+        --depth;
+    }
+    delete n;
+
+    //retrace: the left (or right) subtree of path[level] lost a level
+    for(level = depth - 1; level >= 0; --level) {
+        StackAVLNode<Key, Value>* p = path[level];
+        int b = p->getBalance() + (leftShrunk ? 1 : -1);
+        StackAVLNode<Key, Value>* top = p;
+        if(b == 1 || b == -1) {
+            p->setBalance(b);
+            return;
+        }
+        if(b == 0) {
+            p->setBalance(0);
+        }
+        else {
+            bool shrunk;
+            top = rebalance(p, b, shrunk);
+            replaceChild(path, level, top);
+            if(!shrunk) {
+                return;
+            }
+        }
+        if(level > 0) {
+            leftShrunk = (path[level - 1]->getLeft() == top);
+        }
+    }
+}
+
+/*
+---------------------------------------------------
+End implementations for the StackAVLTree class.
+---------------------------------------------------
+*/
+
+#endif